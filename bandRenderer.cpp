@@ -0,0 +1,53 @@
+#include "bandRenderer.h"
+
+int BandRenderer::bandRows(int w, int samplesPerAxis) const {
+	size_t rowBytes = size_t(w) * renderer.bytesPerPixel(samplesPerAxis);
+	size_t rows = memoryBudget / rowBytes;
+	size_t margin = 2 * renderer.bandMargin(samplesPerAxis);
+	return rows > margin ? int(std::min(rows - margin, size_t(1) << 30)) : 0;
+}
+
+// bands go in the order the file stores its rows, from the top unless it is bottom up
+//
+bool BandRenderer::render(const RenderScene* scene, int w, int h, int samplesPerAxis, const string& path, string& error) {
+	uint64_t start = ofGetElapsedTimeMillis();
+	numBands = 0;
+	samplesTraced = 0;
+	int rows = std::min(bandRows(w, samplesPerAxis), h);
+	if (rows < 1) {
+		error = "a memory budget of " + ofToString(int(memoryBudget >> 20)) + " MB does not hold a band of a " + ofToString(w) + " pixel wide image";
+		return false;
+	}
+	ScanlineWriter writer;
+	if (!writer.open(path, w, h, renderer.getToneMap())) {
+		error = ScanlineWriter::canWrite(path) ? "cannot write " + path : path + ": streamed images must be .ppm, .pfm or .exr";
+		return false;
+	}
+
+	int margin = renderer.bandMargin(samplesPerAxis);
+	int count = (h + rows - 1) / rows;
+	for (int band = 0; band < count; band++) {
+		int first = (writer.isBottomUp() ? count - 1 - band : band) * rows;
+		int last = std::min(first + rows, h);
+		int top = std::max(0, first - margin);
+		int bottom = std::min(h, last + margin);
+
+		renderer.setBand(h, top);
+		renderer.start(scene, w, bottom - top, samplesPerAxis);
+		renderer.wait();
+		samplesTraced += renderer.getSamplesTraced();
+		numBands++;
+		if (!writer.write(renderer.getFrameBuffer(), first - top, last - top)) {
+			error = "cannot write " + path;
+			break;
+		}
+	}
+	renderer.setBand(0, 0);
+	renderTime = ofGetElapsedTimeMillis() - start;
+	if (numBands < count) return false;
+	if (!writer.close()) {
+		error = "cannot write " + path;
+		return false;
+	}
+	return true;
+}
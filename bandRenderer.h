@@ -0,0 +1,46 @@
+#pragma once
+
+#include "progressiveRenderer.h"
+#include "scanlineWriter.h"
+
+//  Band renderer
+//
+//  Renders images too big to hold in memory, such as posters tens of thousands of
+//  pixels across.  The image is cut into bands of whole rows, as many as fit in the
+//  memory budget; each band is rendered by the ProgressiveRenderer as a band of the
+//  whole image (see setBand), then tonemapped or converted and written straight to a
+//  ScanlineWriter, and its buffers are reused for the next one.  The renderer's memory
+//  stays within the budget whatever the size of the image.  The scene is not counted.
+//
+//  Bands are put together exactly as the image would have been rendered in one piece.
+//  With adaptive sampling every band is rendered with a few extra rows on either side,
+//  which are thrown away.
+//
+class BandRenderer {
+public:
+	BandRenderer(ProgressiveRenderer& renderer) : renderer(renderer) {}
+
+	void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+	size_t getMemoryBudget() const { return memoryBudget; }
+
+	// rows of a w wide image a band can have, 0 if not even one row fits the budget
+	//
+	int bandRows(int w, int samplesPerAxis) const;
+
+	// render a w x h image of the scene into path (.ppm, .pfm or .exr, see
+	// ScanlineWriter) with the renderer's settings.  Blocks until the file is written.
+	// Returns false with the reason in error if it cannot be
+	//
+	bool render(const RenderScene* scene, int w, int h, int samplesPerAxis, const string& path, string& error);
+
+	int getNumBands() const { return numBands; }
+	uint64_t getRenderTime() const { return renderTime; }          // ms, with writing
+	uint64_t getSamplesTraced() const { return samplesTraced; }    // camera rays, with the extra rows
+
+private:
+	ProgressiveRenderer& renderer;
+	size_t memoryBudget = size_t(256) << 20;
+	int numBands = 0;
+	uint64_t renderTime = 0;
+	uint64_t samplesTraced = 0;
+};
@@ -0,0 +1,116 @@
+#include "bvh.h"
+
+// number of bins the centroids are sorted into when searching for a split
+//
+static const int numBins = 16;
+static const int maxLeafSize = 4;
+
+void BVH::build(const std::vector<AABB>& primBounds) {
+	clear();
+	int n = (int)primBounds.size();
+	if (n == 0) return;
+
+	std::vector<glm::vec3> centroids(n);
+	primIndices.resize(n);
+	for (int i = 0; i < n; i++) {
+		primIndices[i] = i;
+		centroids[i] = primBounds[i].center();
+	}
+
+	nodes.reserve(2 * n);
+	nodes.push_back(BVHNode());
+	nodes[0].leftFirst = 0;
+	nodes[0].count = n;
+	subdivide(0, primBounds, centroids, 0);
+	nodes.shrink_to_fit();
+}
+
+void BVH::subdivide(int nodeIndex, const std::vector<AABB>& primBounds, const std::vector<glm::vec3>& centroids, int depth) {
+	int first = nodes[nodeIndex].leftFirst;
+	int count = nodes[nodeIndex].count;
+
+	AABB bounds, centroidBounds;
+	for (int i = first; i < first + count; i++) {
+		bounds.grow(primBounds[primIndices[i]]);
+		centroidBounds.grow(centroids[primIndices[i]]);
+	}
+	nodes[nodeIndex].bounds = bounds;
+	if (count <= 1 || depth >= maxDepth) return;
+
+	// find the cheapest split plane over all three axes.  cost of a split is
+	// countLeft * areaLeft + countRight * areaRight (traversal and intersection cost
+	// taken as equal), compared against count * area for keeping this node a leaf
+	//
+	float bestCost = std::numeric_limits<float>::infinity();
+	int bestAxis = -1, bestBin = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		float lo = centroidBounds.min[axis], hi = centroidBounds.max[axis];
+		if (hi <= lo) continue;
+
+		AABB binBounds[numBins];
+		int binCount[numBins] = {};
+		float scale = numBins / (hi - lo);
+		for (int i = first; i < first + count; i++) {
+			int b = std::min(numBins - 1, (int)((centroids[primIndices[i]][axis] - lo) * scale));
+			binCount[b]++;
+			binBounds[b].grow(primBounds[primIndices[i]]);
+		}
+
+		// sweep from the right to get the cost of everything above each plane, then from
+		// the left to combine it with everything below
+		//
+		float rightArea[numBins - 1];
+		int rightCount[numBins - 1];
+		AABB box;
+		int sum = 0;
+		for (int b = numBins - 1; b > 0; b--) {
+			box.grow(binBounds[b]);
+			sum += binCount[b];
+			rightArea[b - 1] = box.area();
+			rightCount[b - 1] = sum;
+		}
+		box = AABB();
+		sum = 0;
+		for (int b = 0; b < numBins - 1; b++) {
+			box.grow(binBounds[b]);
+			sum += binCount[b];
+			float cost = sum * box.area() + rightCount[b] * rightArea[b];
+			if (sum > 0 && rightCount[b] > 0 && cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	float leafCost = count * bounds.area();
+	int mid;
+	if (bestAxis >= 0) {
+		if (bestCost >= leafCost && count <= maxLeafSize) return;
+		float lo = centroidBounds.min[bestAxis];
+		float scale = numBins / (centroidBounds.max[bestAxis] - lo);
+		int* begin = &primIndices[first];
+		int* split = std::partition(begin, begin + count, [&](int p) {
+			return std::min(numBins - 1, (int)((centroids[p][bestAxis] - lo) * scale)) <= bestBin;
+		});
+		mid = first + (int)(split - begin);
+	}
+	else {
+		// every centroid in the same place: nothing to separate them by, just halve the list
+		if (count <= maxLeafSize) return;
+		mid = first + count / 2;
+	}
+
+	int left = (int)nodes.size();
+	nodes.push_back(BVHNode());
+	nodes.push_back(BVHNode());
+	nodes[left].leftFirst = first;
+	nodes[left].count = mid - first;
+	nodes[left + 1].leftFirst = mid;
+	nodes[left + 1].count = first + count - mid;
+	nodes[nodeIndex].leftFirst = left;
+	nodes[nodeIndex].count = 0;
+
+	subdivide(left, primBounds, centroids, depth + 1);
+	subdivide(left + 1, primBounds, centroids, depth + 1);
+}
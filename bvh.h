@@ -0,0 +1,170 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+//  Axis aligned bounding box
+//
+class AABB {
+public:
+	AABB() {}
+	AABB(const glm::vec3& min, const glm::vec3& max) { this->min = min; this->max = max; }
+
+	void grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+	void grow(const AABB& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+	bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	glm::vec3 extent() const { return max - min; }
+
+	// half of the surface area, which is all the SAH needs
+	//
+	float area() const {
+		if (isEmpty()) return 0;
+		glm::vec3 e = extent();
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	// slab test.  Returns the distance at which the ray enters the box, or infinity if
+	// it misses the box or enters it beyond tMax.  tFar is pushed out by the most the
+	// rounding can have pulled it in (Ize 2013), so a ray that grazes the corner two
+	// boxes share is never turned away by both
+	//
+	float intersect(const glm::vec3& o, const glm::vec3& invD, float tMax) const {
+		float tx0 = (min.x - o.x) * invD.x, tx1 = (max.x - o.x) * invD.x;
+		float ty0 = (min.y - o.y) * invD.y, ty1 = (max.y - o.y) * invD.y;
+		float tz0 = (min.z - o.z) * invD.z, tz1 = (max.z - o.z) * invD.z;
+		float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::min(tz0, tz1));
+		float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1)) * 1.0000004f;
+		if (tFar < 0 || tNear > tFar || tNear > tMax) return std::numeric_limits<float>::infinity();
+		return tNear;
+	}
+
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+};
+
+//  BVH node (32 bytes).  Interior nodes have count == 0 and their two children stored
+//  next to each other at leftFirst and leftFirst + 1.  Leaves hold count primitives,
+//  starting at primIndices[leftFirst].
+//
+struct BVHNode {
+	AABB bounds;
+	int leftFirst = 0;
+	int count = 0;
+
+	bool isLeaf() const { return count > 0; }
+};
+
+//  Bounding volume hierarchy over a list of primitive bounds, built with the binned
+//  surface area heuristic.  The BVH only knows about boxes; the caller supplies the
+//  primitive test to the traversal functions, and primitives are referred to by their
+//  index in the list that was passed to build().
+//
+class BVH {
+public:
+	void build(const std::vector<AABB>& primBounds);
+	void clear() { nodes.clear(); primIndices.clear(); }
+	bool isEmpty() const { return nodes.empty(); }
+
+	// closest hit traversal.  hitPrim(prim, tMax) tests one primitive and, if it is hit
+	// closer than tMax, shrinks tMax to the new distance.  Children are visited near to
+	// far and anything beyond the current tMax is skipped.  If boxTests is given, the
+	// node boxes tested are added to it
+	//
+	template<typename HitPrim>
+	void closestHit(const glm::vec3& o, const glm::vec3& d, float& tMax, HitPrim hitPrim, uint64_t* boxTests = nullptr) const;
+
+	// any hit traversal.  hitPrim(prim) returns true if the primitive blocks the ray,
+	// which ends the traversal straight away
+	//
+	template<typename HitPrim>
+	bool anyHit(const glm::vec3& o, const glm::vec3& d, float tMax, HitPrim hitPrim, uint64_t* boxTests = nullptr) const;
+
+	std::vector<BVHNode> nodes;
+	std::vector<int> primIndices;
+
+	static const int maxDepth = 60;    // keeps the traversal stacks below from overflowing
+
+private:
+	void subdivide(int nodeIndex, const std::vector<AABB>& primBounds, const std::vector<glm::vec3>& centroids, int depth);
+};
+
+template<typename HitPrim>
+void BVH::closestHit(const glm::vec3& o, const glm::vec3& d, float& tMax, HitPrim hitPrim, uint64_t* boxTests) const {
+	if (nodes.empty()) return;
+	glm::vec3 invD = 1.0f / d;
+	if (boxTests != nullptr) ++*boxTests;
+	if (nodes[0].bounds.intersect(o, invD, tMax) == std::numeric_limits<float>::infinity()) return;
+
+	int stack[maxDepth + 4];
+	int sp = 0;
+	int node = 0;
+	for (;;) {
+		const BVHNode& n = nodes[node];
+		if (n.isLeaf()) {
+			for (int i = 0; i < n.count; i++) {
+				hitPrim(primIndices[n.leftFirst + i], tMax);
+			}
+			if (sp == 0) return;
+			node = stack[--sp];
+			continue;
+		}
+
+		int nearChild = n.leftFirst, farChild = n.leftFirst + 1;
+		if (boxTests != nullptr) *boxTests += 2;
+		float tNear = nodes[nearChild].bounds.intersect(o, invD, tMax);
+		float tFar = nodes[farChild].bounds.intersect(o, invD, tMax);
+		if (tFar < tNear) {
+			std::swap(nearChild, farChild);
+			std::swap(tNear, tFar);
+		}
+		if (tNear == std::numeric_limits<float>::infinity()) {
+			if (sp == 0) return;
+			node = stack[--sp];
+			continue;
+		}
+		node = nearChild;
+		if (tFar != std::numeric_limits<float>::infinity()) stack[sp++] = farChild;
+	}
+}
+
+template<typename HitPrim>
+bool BVH::anyHit(const glm::vec3& o, const glm::vec3& d, float tMax, HitPrim hitPrim, uint64_t* boxTests) const {
+	if (nodes.empty()) return false;
+	glm::vec3 invD = 1.0f / d;
+	if (boxTests != nullptr) ++*boxTests;
+	if (nodes[0].bounds.intersect(o, invD, tMax) == std::numeric_limits<float>::infinity()) return false;
+
+	int stack[maxDepth + 4];
+	int sp = 0;
+	int node = 0;
+	for (;;) {
+		const BVHNode& n = nodes[node];
+		if (n.isLeaf()) {
+			for (int i = 0; i < n.count; i++) {
+				if (hitPrim(primIndices[n.leftFirst + i])) return true;
+			}
+		}
+		else {
+			// order does not matter for an any hit query
+			int left = n.leftFirst, right = n.leftFirst + 1;
+			if (boxTests != nullptr) *boxTests += 2;
+			bool hitLeft = nodes[left].bounds.intersect(o, invD, tMax) != std::numeric_limits<float>::infinity();
+			bool hitRight = nodes[right].bounds.intersect(o, invD, tMax) != std::numeric_limits<float>::infinity();
+			if (hitLeft && hitRight) {
+				stack[sp++] = right;
+				node = left;
+				continue;
+			}
+			if (hitLeft || hitRight) {
+				node = hitLeft ? left : right;
+				continue;
+			}
+		}
+		if (sp == 0) return false;
+		node = stack[--sp];
+	}
+}
@@ -0,0 +1,92 @@
+#include "frameBuffer.h"
+#include "scanlineWriter.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FRAME_BUFFER_X86
+#include <emmintrin.h>
+#endif
+
+void FrameBuffer::allocate(int w, int h) {
+	width = w;
+	height = h;
+	data.assign(4 * size_t(w) * h, 0.0f);
+}
+
+void FrameBuffer::clear(const glm::vec3& color) {
+	for (size_t i = 0; i < data.size(); i += 4) {
+		data[i] = color.x;
+		data[i + 1] = color.y;
+		data[i + 2] = color.z;
+		data[i + 3] = 1;
+	}
+}
+
+// one pixel at a time, all four channels in one register:  divide by the sample count,
+// expose, tonemap, clamp, round to bytes
+//
+static void resolvePixels(const float* in, unsigned char* out, size_t n, const ToneMap& toneMap) {
+	bool reinhard = toneMap.op == ToneMap::REINHARD;
+
+#ifdef FRAME_BUFFER_X86
+	const __m128 exposure = _mm_set1_ps(toneMap.exposure);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	for (size_t i = 0; i < n; i++, in += 4, out += 3) {
+		__m128 c = _mm_loadu_ps(in);
+		__m128 count = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 weight = _mm_and_ps(_mm_cmpgt_ps(count, zero), _mm_div_ps(exposure, count));
+		c = _mm_mul_ps(c, weight);
+		if (reinhard) c = _mm_div_ps(c, _mm_add_ps(one, _mm_max_ps(c, zero)));
+		c = _mm_min_ps(_mm_max_ps(c, zero), one);
+		__m128i bytes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, scale), half));
+		bytes = _mm_packs_epi32(bytes, bytes);
+		bytes = _mm_packus_epi16(bytes, bytes);
+		uint32_t rgba = (uint32_t)_mm_cvtsi128_si32(bytes);
+		out[0] = rgba & 0xff;
+		out[1] = (rgba >> 8) & 0xff;
+		out[2] = (rgba >> 16) & 0xff;
+	}
+#else
+	for (size_t i = 0; i < n; i++, in += 4, out += 3) {
+		float weight = in[3] > 0 ? toneMap.exposure / in[3] : 0;
+		for (int k = 0; k < 3; k++) {
+			float c = in[k] * weight;
+			if (reinhard) c = c / (1 + std::max(c, 0.0f));
+			out[k] = (unsigned char)(ofClamp(c, 0, 1) * 255 + 0.5f);
+		}
+	}
+#endif
+}
+
+void FrameBuffer::resolve(ofPixels& pixels, const ToneMap& toneMap) const {
+	if (pixels.getWidth() != width || pixels.getHeight() != height || pixels.getNumChannels() != 3)
+		pixels.allocate(width, height, OF_IMAGE_COLOR);
+	resolvePixels(data.data(), pixels.getData(), size_t(width) * height, toneMap);
+}
+
+void FrameBuffer::resolveRow(int y, unsigned char* out, const ToneMap& toneMap) const {
+	resolvePixels(&data[4 * size_t(y) * width], out, width, toneMap);
+}
+
+void FrameBuffer::resolve(ofPixels& pixels, const ToneMap& toneMap, int x0, int y0, int x1, int y1) const {
+	if (pixels.getWidth() != width || pixels.getHeight() != height || pixels.getNumChannels() != 3) {
+		resolve(pixels, toneMap);
+		return;
+	}
+	for (int y = y0; y < y1; y++) {
+		size_t first = size_t(y) * width + x0;
+		resolvePixels(&data[4 * first], pixels.getData() + 3 * first, x1 - x0, toneMap);
+	}
+}
+
+bool FrameBuffer::isHDRFile(const string& path) {
+	string ext = ofToLower(ofFilePath::getFileExt(path));
+	return ext == "pfm" || ext == "exr";
+}
+
+bool FrameBuffer::save(const string& path) const {
+	ScanlineWriter writer;
+	return isHDRFile(path) && writer.open(path, width, height) && writer.write(*this, 0, height) && writer.close();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Colors while rendering are linear floats, scaled so that 1 is full 8 bit intensity,
+//  and nothing is clamped until the image is written out.  These convert to and from
+//  the ofColors of the scene and the 8 bit images
+//
+inline glm::vec3 linearColor(const ofColor& c) {
+	return glm::vec3(c.r, c.g, c.b) / 255.0f;
+}
+
+inline ofColor quantizeColor(const glm::vec3& c) {
+	return ofColor(ofClamp(c.x, 0, 1) * 255 + 0.5f, ofClamp(c.y, 0, 1) * 255 + 0.5f, ofClamp(c.z, 0, 1) * 255 + 0.5f);
+}
+
+//  How the float image becomes 8 bits:  scale by exposure, then either clip at 1 (the
+//  look of the 8 bit renders) or compress highlights with Reinhard's c / (1 + c)
+//
+struct ToneMap {
+	enum Operator { CLAMP, REINHARD };
+
+	Operator op = CLAMP;
+	float exposure = 1;
+
+	bool operator==(const ToneMap& t) const { return op == t.op && exposure == t.exposure; }
+};
+
+//  Float framebuffer
+//
+//  The target every render accumulates into.  Each pixel is RGBA float: the sum of the
+//  samples that landed in it, and their count in the fourth channel, so passes can keep
+//  adding samples without losing precision and the pixel is always their average.
+//  Rows run top to bottom like ofPixels.
+//
+//  resolve() and resolveRow() are the only places colors are clamped and quantized.
+//  The float image can also be saved as it is, to PFM or OpenEXR.
+//
+class FrameBuffer {
+public:
+	void allocate(int w, int h);
+	void clear(const glm::vec3& color);        // every pixel holds one sample of color
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	bool isAllocated() const { return !data.empty(); }
+	float* getData() { return data.data(); }
+	const float* getData() const { return data.data(); }
+
+	// replace the pixel with one sample, or add another sample to it
+	//
+	void set(int x, int y, const glm::vec3& color) {
+		float* p = &data[4 * (size_t(y) * width + x)];
+		p[0] = color.x;
+		p[1] = color.y;
+		p[2] = color.z;
+		p[3] = 1;
+	}
+	void add(int x, int y, const glm::vec3& color) {
+		float* p = &data[4 * (size_t(y) * width + x)];
+		p[0] += color.x;
+		p[1] += color.y;
+		p[2] += color.z;
+		p[3] += 1;
+	}
+
+	int getSamples(int x, int y) const { return int(data[4 * (size_t(y) * width + x) + 3] + 0.5f); }
+
+	// the average of the pixel's samples (black if it has none)
+	//
+	glm::vec3 getColor(int x, int y) const {
+		const float* p = &data[4 * (size_t(y) * width + x)];
+		return p[3] > 0 ? glm::vec3(p[0], p[1], p[2]) / p[3] : glm::vec3(0);
+	}
+
+	// tonemap and quantize into 8 bit RGB pixels of the same size
+	//
+	void resolve(ofPixels& pixels, const ToneMap& toneMap = ToneMap()) const;
+
+	// the same for the pixels [x0, x1) x [y0, y1) only, leaving the rest of pixels as it
+	// is.  pixels must be of the same size already, or the whole image is resolved
+	//
+	void resolve(ofPixels& pixels, const ToneMap& toneMap, int x0, int y0, int x1, int y1) const;
+
+	// tonemap and quantize row y into width 8 bit RGB pixels at out
+	//
+	void resolveRow(int y, unsigned char* out, const ToneMap& toneMap = ToneMap()) const;
+
+	// write the averaged float image, as PFM or OpenEXR from the extension (see
+	// ScanlineWriter).  Returns false for other extensions or if it cannot be written
+	//
+	bool save(const string& path) const;
+	static bool isHDRFile(const string& path);
+
+private:
+	int width = 0, height = 0;
+	vector<float> data;
+};
@@ -0,0 +1,157 @@
+#include "imagePyramid.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IMAGE_PYRAMID_X86
+#include <emmintrin.h>
+#endif
+
+static float sinc(float x) {
+	if (x == 0) return 1;
+	x *= PI;
+	return sinf(x) / x;
+}
+
+// dst[i] += w * src[i] for n floats, n a multiple of 4
+//
+static void multiplyAdd(float* dst, const float* src, float w, int n) {
+#ifdef IMAGE_PYRAMID_X86
+	__m128 weight = _mm_set1_ps(w);
+	for (int i = 0; i < n; i += 4) {
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(weight, _mm_loadu_ps(src + i))));
+	}
+#else
+	for (int i = 0; i < n; i++) dst[i] += w * src[i];
+#endif
+}
+
+// a framebuffer pixel (sum of samples, count) to its average with a count of 1
+//
+static void averageSamples(float* dst, const float* src) {
+#ifdef IMAGE_PYRAMID_X86
+	__m128 c = _mm_loadu_ps(src);
+	__m128 count = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128 weight = _mm_and_ps(_mm_cmpgt_ps(count, _mm_setzero_ps()), _mm_div_ps(_mm_set1_ps(1.0f), count));
+	c = _mm_mul_ps(c, weight);
+	_mm_storeu_ps(dst, c);
+	dst[3] = 1;
+#else
+	float weight = src[3] > 0 ? 1 / src[3] : 0;
+	for (int k = 0; k < 3; k++) dst[k] = src[k] * weight;
+	dst[3] = 1;
+#endif
+}
+
+// filter one row of RGBA pixels across:  pixel x of dst is the weighted sum of the
+// pixels tapped for it
+//
+static void filterRow(float* dst, int dstWidth, const float* src, int srcWidth, int count, const int* first, const float* weights) {
+	for (int x = 0; x < dstWidth; x++, weights += count) {
+#ifdef IMAGE_PYRAMID_X86
+		__m128 sum = _mm_setzero_ps();
+		for (int t = 0; t < count; t++) {
+			int s = std::min(std::max(first[x] + t, 0), srcWidth - 1);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(src + 4 * s)));
+		}
+		_mm_storeu_ps(dst + 4 * x, sum);
+#else
+		float sum[4] = { 0, 0, 0, 0 };
+		for (int t = 0; t < count; t++) {
+			int s = std::min(std::max(first[x] + t, 0), srcWidth - 1);
+			for (int k = 0; k < 4; k++) sum[k] += weights[t] * src[4 * s + k];
+		}
+		for (int k = 0; k < 4; k++) dst[4 * x + k] = sum[k];
+#endif
+	}
+}
+
+ImagePyramid::Taps ImagePyramid::makeTaps(int dstSize, int factor, Filter filter) {
+	Taps taps;
+	if (filter == BOX) {
+		taps.count = factor;
+		for (int o = 0; o < dstSize; o++) {
+			taps.first.push_back(o * factor);
+			for (int t = 0; t < factor; t++) taps.weights.push_back(1.0f / factor);
+		}
+		return taps;
+	}
+
+	// kernels are in units of output pixels:  tent over [-1, 1], Lanczos 2 over [-2, 2]
+	//
+	float radius = (filter == TENT ? 1 : 2) * factor;
+	taps.count = 2 * int(ceilf(radius)) + 1;
+	for (int o = 0; o < dstSize; o++) {
+		float center = (o + 0.5f) * factor - 0.5f;
+		int first = int(floorf(center)) - int(ceilf(radius));
+		float sum = 0;
+		taps.first.push_back(first);
+		for (int t = 0; t < taps.count; t++) {
+			float x = fabsf(first + t - center) / factor;
+			float w = filter == TENT ? std::max(0.0f, 1 - x) : (x < 2 ? sinc(x) * sinc(x / 2) : 0);
+			taps.weights.push_back(w);
+			sum += w;
+		}
+		for (int t = 0; t < taps.count; t++) taps.weights[o * taps.count + t] /= sum;
+	}
+	return taps;
+}
+
+void ImagePyramid::build(const FrameBuffer& image, int factor, Filter filter) {
+	this->factor = factor;
+	levels.clear();
+	stages.clear();
+
+	int w = image.getWidth(), h = image.getHeight();
+	while (factor > 0 && w / factor >= 1 && h / factor >= 1) {
+		levels.emplace_back();
+		levels.back().allocate(w / factor, h / factor);
+		Stage stage;
+		stage.srcWidth = w;
+		stage.srcHeight = h;
+		stage.across = makeTaps(w / factor, factor, filter);
+		stage.down = makeTaps(h / factor, factor, filter);
+		stage.ring.assign(4 * size_t(stage.down.count) * (w / factor), 0.0f);
+		stage.out = &levels.back();
+		stages.push_back(std::move(stage));
+		w /= factor;
+		h /= factor;
+		if (factor == 1) break;
+	}
+	if (stages.empty()) return;
+
+	// the only pass over the image:  average each pixel's samples and send the row down
+	//
+	int width = image.getWidth();
+	vector<float> row(4 * size_t(width));
+	for (int y = 0; y < image.getHeight(); y++) {
+		const float* src = image.getData() + 4 * size_t(y) * width;
+		for (int x = 0; x < width; x++) averageSamples(&row[4 * x], src + 4 * x);
+		feed(0, y, row.data());
+	}
+	stages.clear();
+}
+
+// source row number row has arrived at a stage.  Filter it across into the ring, then
+// finish every output row whose taps are all in, and pass those on to the next stage
+//
+void ImagePyramid::feed(int s, int row, const float* pixels) {
+	Stage& stage = stages[s];
+	int width = stage.out->getWidth();
+	int rowFloats = 4 * width;
+	filterRow(&stage.ring[(row % stage.down.count) * rowFloats], width, pixels, stage.srcWidth,
+		stage.across.count, &stage.across.first[0], &stage.across.weights[0]);
+
+	while (stage.nextRow < stage.out->getHeight()) {
+		int o = stage.nextRow;
+		int first = stage.down.first[o];
+		if (std::min(stage.srcHeight - 1, first + stage.down.count - 1) > row) break;
+
+		float* out = stage.out->getData() + size_t(o) * rowFloats;
+		std::fill(out, out + rowFloats, 0.0f);
+		for (int t = 0; t < stage.down.count; t++) {
+			int src = std::min(std::max(first + t, 0), stage.srcHeight - 1);
+			multiplyAdd(out, &stage.ring[(src % stage.down.count) * rowFloats], stage.down.weights[o * stage.down.count + t], rowFloats);
+		}
+		stage.nextRow++;
+		if (s + 1 < stages.size()) feed(s + 1, o, out);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "frameBuffer.h"
+#include <deque>
+
+//  Image pyramid
+//
+//  The reductions of a float image by factor, factor^2, factor^3 ... for the SSAA
+//  filter, all built in one streaming pass:  every row of the image is read once,
+//  filtered across into a small ring of rows per level, and as soon as a level has the
+//  rows an output row needs, the row is filtered down and fed to the next level.  The
+//  rows in flight stay in cache, and each pixel is one 4 float SSE register.
+//
+//  Filters are separable, with weights normalized to sum to 1 and clamped edges:
+//
+//    - BOX averages each factor x factor block (what the SSAA loops did)
+//    - TENT is linear over twice the block width, blurring a little across blocks
+//    - LANCZOS is Lanczos 2 scaled to the block size, the sharpest of the three
+//
+//  Level k is factor^k times smaller than the image (sizes round down), and each level
+//  is filtered from the one above it.
+//
+class ImagePyramid {
+public:
+	enum Filter { BOX, TENT, LANCZOS };
+
+	// reduce image until a level would be less than a pixel across, or only once for
+	// a factor of 1
+	//
+	void build(const FrameBuffer& image, int factor, Filter filter);
+	void clear() { levels.clear(); }
+
+	int getNumLevels() const { return levels.size(); }
+	int getFactor() const { return factor; }
+
+	// level 1 is the first reduction.  Pixels hold one sample each
+	//
+	const FrameBuffer& getLevel(int level) const { return levels[level - 1]; }
+
+private:
+	// the source pixels and weights of every output pixel along one axis.  Sources may be
+	// outside the image and are clamped when used
+	//
+	struct Taps {
+		int count = 0;
+		vector<int> first;
+		vector<float> weights;     // count per output pixel
+	};
+
+	// one level being built:  ring of source rows filtered across, and the next row due
+	//
+	struct Stage {
+		int srcWidth, srcHeight;
+		Taps across, down;
+		vector<float> ring;
+		int nextRow = 0;
+		FrameBuffer* out;
+	};
+
+	static Taps makeTaps(int dstSize, int factor, Filter filter);
+	void feed(int stage, int row, const float* pixels);
+
+	int factor = 1;
+	vector<Stage> stages;
+	std::deque<FrameBuffer> levels;
+};
@@ -0,0 +1,50 @@
+#include "instance.h"
+
+Instance::Instance(const shared_ptr<SceneObject>& prototype, const glm::vec3& position, const glm::mat3& linear) {
+	this->prototype = prototype;
+	this->position = position;
+	setLinear(linear);
+	name = "instance";
+
+	diffuseColor = prototype->diffuseColor;
+	specularColor = prototype->specularColor;
+	textured = prototype->textured;
+	mipTexture = prototype->mipTexture;
+	mipSpecularTexture = prototype->mipSpecularTexture;
+	textureFile = prototype->textureFile;
+	specularTextureFile = prototype->specularTextureFile;
+}
+
+// normals go back with the inverse transpose, so they stay normal to the surface under
+// a scale that is not uniform
+//
+bool Instance::intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+	glm::vec3 p, n;
+	if (!prototype->intersect(prototypeRay(ray), p, n)) return false;
+	point = position + linear * p;
+	normal = glm::normalize(glm::transpose(inverseLinear) * n);
+	return true;
+}
+
+bool Instance::intersectAny(const Ray& ray) {
+	return prototype->intersectAny(prototypeRay(ray));
+}
+
+bool Instance::getBounds(AABB& bounds) {
+	AABB box;
+	if (!prototype->getBounds(box)) return false;
+	bounds = AABB();
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec3 p((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z);
+		bounds.grow(position + linear * p);
+	}
+	return true;
+}
+
+void Instance::draw() {
+	ofPushMatrix();
+	ofTranslate(position);
+	ofMultMatrix(glm::mat4(linear));
+	prototype->draw();
+	ofPopMatrix();
+}
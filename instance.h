@@ -0,0 +1,45 @@
+#pragma once
+
+#include "scene.h"
+
+//  Instance
+//
+//  A placed copy of a shared prototype object, usually a Mesh:  the instance holds only
+//  its placement (position, plus a linear part for rotation and scale) and its material,
+//  and rays are taken into the prototype's space and handed to it.  The prototype keeps
+//  the geometry and its BVH, so the scene BVH over the instances and the one BVH per
+//  prototype make a two level structure, and memory grows with the number of different
+//  models rather than the number of copies.
+//
+//  An instance starts out with the prototype's material.  Textures are shared with it,
+//  not copied.
+//
+class Instance : public SceneObject {
+public:
+	Instance(const shared_ptr<SceneObject>& prototype, const glm::vec3& position, const glm::mat3& linear = glm::mat3(1.0f));
+
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal);
+	bool intersectAny(const Ray& ray);
+	bool getBounds(AABB& bounds);
+	void draw();
+
+	glm::vec2 getIJCoords(glm::vec3 point, int numTiles) { return prototype->getIJCoords(toPrototype(point), numTiles); }
+	glm::vec2 getIJCoordsSpec(glm::vec3 point, int numTiles) { return prototype->getIJCoordsSpec(toPrototype(point), numTiles); }
+
+	// rotation and scale, applied before position
+	//
+	void setLinear(const glm::mat3& m) { linear = m; inverseLinear = glm::inverse(m); }
+	const glm::mat3& getLinear() const { return linear; }
+
+	const shared_ptr<SceneObject>& getPrototype() const { return prototype; }
+
+private:
+	glm::vec3 toPrototype(const glm::vec3& p) const { return inverseLinear * (p - position); }
+
+	// the ray in the prototype's space, with its direction normalized again
+	//
+	Ray prototypeRay(const Ray& ray) const { return Ray(toPrototype(ray.p), glm::normalize(inverseLinear * ray.d)); }
+
+	shared_ptr<SceneObject> prototype;
+	glm::mat3 linear, inverseLinear;
+};
@@ -0,0 +1,55 @@
+#include "lightGrid.h"
+#include <functional>
+#include <cmath>
+
+void LightGrid::build(const std::vector<glm::vec3>& position, const std::vector<float>& radius, const AABB& bounds) {
+	clear();
+	int n = position.size();
+	if (n == 0 || bounds.isEmpty()) return;
+	this->bounds = bounds;
+
+	// cube cells, as many as the volume allows at the target count.  A flat box still
+	// gets at least one cell across
+	//
+	glm::vec3 extent = glm::max(bounds.extent(), glm::vec3(1e-4f));
+	float volume = extent.x * extent.y * extent.z;
+	cellSize = cbrtf(volume / (float(n) * cellsPerLight));
+	for (int axis = 0; axis < 3; axis++) {
+		cellSize = std::max(cellSize, extent[axis] / maxCellsPerAxis);
+	}
+	for (int axis = 0; axis < 3; axis++) {
+		cells[axis] = std::min(std::max(int(ceilf(extent[axis] / cellSize)), 1), maxCellsPerAxis);
+	}
+
+	// count the lights per cell, then fill the lists.  A light goes into the cells of its
+	// box whose nearest point is within its radius
+	//
+	int numCells = cells[0] * cells[1] * cells[2];
+	std::vector<int> count(numCells + 1, 0);
+	auto forCells = [&](int light, const std::function<void(int)>& visit) {
+		const glm::vec3& p = position[light];
+		float r = radius[light];
+		int lo[3], hi[3];
+		for (int axis = 0; axis < 3; axis++) {
+			if (p[axis] + r < bounds.min[axis] || p[axis] - r > bounds.max[axis]) return;
+			lo[axis] = cellOf(p[axis] - r, axis);
+			hi[axis] = cellOf(p[axis] + r, axis);
+		}
+		for (int z = lo[2]; z <= hi[2]; z++) {
+			for (int y = lo[1]; y <= hi[1]; y++) {
+				for (int x = lo[0]; x <= hi[0]; x++) {
+					glm::vec3 cellMin = bounds.min + glm::vec3(x, y, z) * cellSize;
+					glm::vec3 nearest = glm::max(cellMin, glm::min(p, cellMin + glm::vec3(cellSize)));
+					if (glm::distance(p, nearest) <= r) visit((z * cells[1] + y) * cells[0] + x);
+				}
+			}
+		}
+	};
+	for (int light = 0; light < n; light++) forCells(light, [&](int cell) { count[cell + 1]++; });
+	cellStart.resize(numCells + 1);
+	cellStart[0] = 0;
+	for (int cell = 0; cell < numCells; cell++) cellStart[cell + 1] = cellStart[cell] + count[cell + 1];
+	cellLights.resize(cellStart[numCells]);
+	std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	for (int light = 0; light < n; light++) forCells(light, [&](int cell) { cellLights[fill[cell]++] = light; });
+}
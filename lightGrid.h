@@ -0,0 +1,44 @@
+#pragma once
+
+#include "bvh.h"
+
+//  Light grid
+//
+//  Clustered light lists for lights with a limited reach:  a uniform grid over a box
+//  (the bounds of what gets shaded), where every cell lists the lights whose sphere of
+//  influence overlaps it, in light order.  A shading point then only looks at the
+//  lights of its cell instead of all of them.  Cells are cubes, about cellsPerLight
+//  of them per light (up to maxCellsPerAxis a side), so the lists stay short however
+//  many lights there are.
+//
+class LightGrid {
+public:
+	void build(const std::vector<glm::vec3>& position, const std::vector<float>& radius, const AABB& bounds);
+	void clear() { cellStart.clear(); cellLights.clear(); }
+	bool isEmpty() const { return cellStart.empty(); }
+
+	// the lights that can reach p, as count indices into the build lists.  Null if p is
+	// outside the grid, where any light may
+	//
+	const int* lightsAt(const glm::vec3& p, int& count) const {
+		if (isEmpty() || p.x < bounds.min.x || p.y < bounds.min.y || p.z < bounds.min.z ||
+			p.x > bounds.max.x || p.y > bounds.max.y || p.z > bounds.max.z) return nullptr;
+		int cell = (cellOf(p.z, 2) * cells[1] + cellOf(p.y, 1)) * cells[0] + cellOf(p.x, 0);
+		count = cellStart[cell + 1] - cellStart[cell];
+		return cellLights.data() + cellStart[cell];
+	}
+
+	static const int cellsPerLight = 4;
+	static const int maxCellsPerAxis = 64;
+
+private:
+	int cellOf(float x, int axis) const {
+		return std::min(std::max(int((x - bounds.min[axis]) / cellSize), 0), cells[axis] - 1);
+	}
+
+	AABB bounds;
+	int cells[3] = { 0, 0, 0 };
+	float cellSize = 1;
+	std::vector<int> cellStart;     // per cell, where its lights start in cellLights; one more at the end
+	std::vector<int> cellLights;
+};
@@ -0,0 +1,66 @@
+#include "livePreview.h"
+#include <chrono>
+
+void LivePreview::render(const RenderScene& scene, int w, int h, const ToneMap& toneMap, float setupTime) {
+	auto start = std::chrono::steady_clock::now();
+	int iw = std::max(1, int(w * std::min(quality, 1.0f) + 0.5f));
+	int ih = std::max(1, int(h * std::min(quality, 1.0f) + 0.5f));
+	int n = samplesPerAxis;
+	if (image.getWidth() != iw || image.getHeight() != ih) image.allocate(iw, ih);
+	ids.resize(size_t(iw) * ih);
+
+	// a row of a tile at a time, all of its samples together so they go through the
+	// packet tracer.  Rows are counted from the bottom, like ProgressiveRenderer.  A
+	// pixel's id is what its middle sample hit
+	//
+	renderTiles(pool, iw, ih, 16, [&](const Tile& tile, int worker) {
+		int count = tile.width() * n * n;
+		std::vector<float> u(count), v(count);
+		std::vector<glm::vec3> colors(count);
+		std::vector<int> prims(count);
+		ShadowCache shadows;
+		int middle = (n / 2) * n + n / 2;
+		for (int j = tile.y0; j < tile.y1; j++) {
+			int k = 0;
+			for (int i = tile.x0; i < tile.x1; i++) {
+				for (int sx = 0; sx < n; sx++) {
+					for (int sy = 0; sy < n; sy++, k++) {
+						u[k] = (i + (sx + 0.5f) / n) / iw;
+						v[k] = (j + (sy + 0.5f) / n) / ih;
+					}
+				}
+			}
+			scene.traceSamples(u.data(), v.data(), count, 1.0f / (iw * n), 1.0f / (ih * n), colors.data(), nullptr, nullptr, nullptr, prims.data(), &shadows);
+			k = 0;
+			for (int i = tile.x0; i < tile.x1; i++) {
+				glm::vec3 sum(0);
+				ids[size_t(ih - j - 1) * iw + i] = prims[k + middle];
+				for (int s = 0; s < n * n; s++) sum += colors[k++];
+				image.set(i, ih - j - 1, sum / float(n * n));
+			}
+		}
+	});
+	image.resolve(pixels, toneMap);
+	frameTime = setupTime + std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	adapt(frameTime);
+
+	if (!texture.isAllocated() || texture.getWidth() != iw || texture.getHeight() != ih) texture.allocate(pixels);
+	texture.loadData(pixels);
+}
+
+// frame times within a quarter of the target leave the quality alone, so it does not
+// flicker between two resolutions
+//
+void LivePreview::adapt(float ms) {
+	float ratio = targetTime / std::max(ms, 0.1f);
+	if (ratio > 0.8f && ratio < 1.25f) return;
+	quality *= std::min(std::max(std::sqrt(ratio), 0.5f), 2.0f);
+	quality = std::min(std::max(quality, minQuality), float(maxSamplesPerAxis));
+	samplesPerAxis = std::max(1, int(quality));
+}
+
+void LivePreview::draw(float x, float y, float w, float h) {
+	if (!texture.isAllocated()) return;
+	ofSetColor(255);
+	texture.draw(x, y, w, h);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "renderScene.h"
+#include "tileRenderer.h"
+
+//  Live preview
+//
+//  Ray traces the scene once a frame for the interactive view.  The resolution and
+//  sampling change from frame to frame to keep the trace near a target time, and the
+//  image is scaled up to the window.
+//
+//  Quality is measured as samples per window pixel along each axis.  Below one, the
+//  image is traced at that fraction of the window resolution; above one, at full
+//  resolution with an n x n grid per pixel.  A frame costs about the square of it.
+//  After every frame it is corrected by the square root of how far the frame time was
+//  off target, by at most a factor of two, so one slow frame does not make the image
+//  jump.  Dragging something in a heavy scene drops the resolution, and a scene left
+//  alone sharpens back up and then gets anti-aliased.
+//
+class LivePreview {
+public:
+	LivePreview(ThreadPool& pool) : pool(pool) {}
+
+	// trace a frame of the scene that will be shown w x h on screen.  Blocks until it is
+	// done; nothing else may be using the pool.  setupTime is what the frame cost before
+	// the trace (compiling the scene), in ms, and counts against the target with it
+	//
+	void render(const RenderScene& scene, int w, int h, const ToneMap& toneMap, float setupTime = 0);
+	void draw(float x, float y, float w, float h);
+
+	// the primitive of the scene of the last frame at (u, v), from the top left corner
+	// of the image (0..1).  -1 for background, or before the first frame
+	//
+	int getId(float u, float v) const {
+		int x = int(u * getWidth()), y = int(v * getHeight());
+		return x < 0 || y < 0 || x >= getWidth() || y >= getHeight() ? -1 : ids[size_t(y) * getWidth() + x];
+	}
+
+	void setTargetTime(float ms) { targetTime = ms; }
+	float getQuality() const { return quality; }
+	int getWidth() const { return image.getWidth(); }
+	int getHeight() const { return image.getHeight(); }
+	int getSamplesPerAxis() const { return samplesPerAxis; }
+	float getFrameTime() const { return frameTime; }       // ms, of the last frame, setup and trace
+
+	static constexpr float minQuality = 1.0f / 16;
+	static const int maxSamplesPerAxis = 3;
+
+private:
+	void adapt(float ms);
+
+	ThreadPool& pool;
+	float targetTime = 30;
+	float quality = 0.25f;
+	int samplesPerAxis = 1;
+	float frameTime = 0;
+	FrameBuffer image;
+	std::vector<int> ids;       // per pixel of image, rows from the top
+	ofPixels pixels;
+	ofTexture texture;
+};
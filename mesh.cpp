@@ -0,0 +1,504 @@
+#include "mesh.h"
+#include "mappedFile.h"
+#include <unordered_map>
+#include <cstring>
+
+Mesh::TriangleRay::TriangleRay(const Ray& ray, const glm::vec3& position, float scale) {
+	o = (ray.p - position) / scale;
+	d = ray.d / scale;
+	glm::vec3 a = glm::abs(d);
+	kz = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+	kx = (kz + 1) % 3;
+	ky = (kx + 1) % 3;
+	if (d[kz] < 0) std::swap(kx, ky);    // keeps the winding, so the edge signs mean the same
+	sx = d[kx] / d[kz];
+	sy = d[ky] / d[kz];
+	sz = 1.0f / d[kz];
+}
+
+// edge functions of the triangle as seen down the ray, after the shear.  An edge
+// function that comes out exactly zero is worked out again in double, which is what
+// makes the test watertight:  the two triangles of a shared edge then agree on which
+// side of it the ray passes
+//
+bool Mesh::hitTriangle(int tri, const TriangleRay& r, float tMax, float& t, float& b1, float& b2) const {
+	const uint32_t* v = &indices[3 * tri];
+	glm::vec3 a = vertices[v[0]] - r.o, b = vertices[v[1]] - r.o, c = vertices[v[2]] - r.o;
+	float ax = a[r.kx] - r.sx * a[r.kz], ay = a[r.ky] - r.sy * a[r.kz];
+	float bx = b[r.kx] - r.sx * b[r.kz], by = b[r.ky] - r.sy * b[r.kz];
+	float cx = c[r.kx] - r.sx * c[r.kz], cy = c[r.ky] - r.sy * c[r.kz];
+
+	float u = cx * by - cy * bx;
+	float w1 = ax * cy - ay * cx;
+	float w2 = bx * ay - by * ax;
+	if (u == 0 || w1 == 0 || w2 == 0) {
+		u = float(double(cx) * by - double(cy) * bx);
+		w1 = float(double(ax) * cy - double(ay) * cx);
+		w2 = float(double(bx) * ay - double(by) * ax);
+	}
+	if ((u < 0 || w1 < 0 || w2 < 0) && (u > 0 || w1 > 0 || w2 > 0)) return false;
+	float det = u + w1 + w2;
+	if (det == 0) return false;
+
+	// t = T / det, kept in (0, tMax) without dividing first
+	//
+	float T = u * r.sz * a[r.kz] + w1 * r.sz * b[r.kz] + w2 * r.sz * c[r.kz];
+	if (det < 0 ? (T >= 0 || T <= tMax * det) : (T <= 0 || T >= tMax * det)) return false;
+	float inverse = 1.0f / det;
+	t = T * inverse;
+	b1 = w1 * inverse;
+	b2 = w2 * inverse;
+	return true;
+}
+
+// the normal faces the ray.  With vertex normals it is interpolated, and turned to the
+// same side as the face
+//
+bool Mesh::intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+	TriangleRay r(ray, position, scale);
+	float tMax = std::numeric_limits<float>::infinity();
+	int hit = -1;
+	float hitB1 = 0, hitB2 = 0;
+	bvh.closestHit(r.o, r.d, tMax, [&](int tri, float& limit) {
+		float t, b1, b2;
+		if (hitTriangle(tri, r, limit, t, b1, b2)) {
+			limit = t;
+			hit = tri;
+			hitB1 = b1;
+			hitB2 = b2;
+		}
+	});
+	if (hit < 0) return false;
+
+	const uint32_t* v = &indices[3 * hit];
+	glm::vec3 face = glm::normalize(glm::cross(vertices[v[1]] - vertices[v[0]], vertices[v[2]] - vertices[v[0]]));
+	if (glm::dot(face, ray.d) > 0) face = -face;
+	normal = face;
+	if (!normals.empty()) {
+		glm::vec3 smooth = (1 - hitB1 - hitB2) * normals[v[0]] + hitB1 * normals[v[1]] + hitB2 * normals[v[2]];
+		if (glm::dot(smooth, smooth) > 0) {
+			smooth = glm::normalize(smooth);
+			normal = glm::dot(smooth, face) < 0 ? -smooth : smooth;
+		}
+	}
+	point = ray.p + tMax * ray.d;
+	return true;
+}
+
+bool Mesh::intersectAny(const Ray& ray) {
+	TriangleRay r(ray, position, scale);
+	float inf = std::numeric_limits<float>::infinity();
+	return bvh.anyHit(r.o, r.d, inf, [&](int tri) {
+		float t, b1, b2;
+		return hitTriangle(tri, r, inf, t, b1, b2);
+	});
+}
+
+bool Mesh::getBounds(AABB& bounds) {
+	if (objectBounds.isEmpty()) return false;
+	glm::vec3 a = position + scale * objectBounds.min, b = position + scale * objectBounds.max;
+	bounds = AABB(glm::min(a, b), glm::max(a, b));
+	return true;
+}
+
+void Mesh::draw() {
+	if (drawMesh == nullptr) {
+		drawMesh.reset(new ofVboMesh());
+		drawMesh->setMode(OF_PRIMITIVE_TRIANGLES);
+		drawMesh->addVertices(vertices);
+		if (!normals.empty()) drawMesh->addNormals(normals);
+		drawMesh->addIndices(indices);
+	}
+	ofPushMatrix();
+	ofTranslate(position);
+	ofScale(scale);
+	drawMesh->draw();
+	ofPopMatrix();
+}
+
+void Mesh::setTriangles(vector<glm::vec3>& vertices, vector<glm::vec3>& normals, vector<uint32_t>& indices) {
+	this->vertices.swap(vertices);
+	this->normals.swap(normals);
+	this->indices.swap(indices);
+	if (this->normals.size() != this->vertices.size()) this->normals.clear();
+	build();
+}
+
+void Mesh::build() {
+	objectBounds = AABB();
+	for (const glm::vec3& v : vertices) objectBounds.grow(v);
+	vector<AABB> bounds(numTriangles());
+	for (int tri = 0; tri < numTriangles(); tri++) {
+		for (int k = 0; k < 3; k++) bounds[tri].grow(vertices[indices[3 * tri + k]]);
+	}
+	bvh.build(bounds);
+	drawMesh.reset();
+}
+
+// Loading
+//
+// both formats are parsed straight out of a memory mapping of the file, without
+// streams or per line allocations
+//
+
+namespace {
+
+// a position in text that cannot run past the end
+//
+struct TextCursor {
+	const char* p;
+	const char* end;
+
+	void skipSpace() {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	}
+	bool atLineEnd() {
+		skipSpace();
+		return p >= end || *p == '\n' || *p == '#';
+	}
+	void nextLine() {
+		const char* eol = (const char*)memchr(p, '\n', end - p);
+		p = eol != nullptr ? eol + 1 : end;
+	}
+	string word() {
+		skipSpace();
+		const char* start = p;
+		while (p < end && !isspace((unsigned char)*p)) p++;
+		return string(start, p);
+	}
+	bool integer(long& value) {
+		skipSpace();
+		bool negative = p < end && *p == '-';
+		if (p < end && (*p == '-' || *p == '+')) p++;
+		if (p >= end || !isdigit((unsigned char)*p)) return false;
+		value = 0;
+		while (p < end && isdigit((unsigned char)*p)) value = value * 10 + (*p++ - '0');
+		if (negative) value = -value;
+		return true;
+	}
+
+	// decimal with optional fraction and exponent, good to a float's precision
+	//
+	bool number(double& value) {
+		skipSpace();
+		bool negative = p < end && *p == '-';
+		if (p < end && (*p == '-' || *p == '+')) p++;
+		double mantissa = 0;
+		int exponent = 0, digits = 0;
+		for (; p < end && isdigit((unsigned char)*p); p++, digits++) mantissa = mantissa * 10 + (*p - '0');
+		if (p < end && *p == '.') {
+			for (p++; p < end && isdigit((unsigned char)*p); p++, digits++, exponent--) mantissa = mantissa * 10 + (*p - '0');
+		}
+		if (digits == 0) return false;
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			p++;
+			long e;
+			if (!integer(e)) return false;
+			exponent += e;
+		}
+		value = mantissa * pow(10.0, exponent);
+		if (negative) value = -value;
+		return true;
+	}
+	bool number(float& value) {
+		double d;
+		if (!number(d)) return false;
+		value = float(d);
+		return true;
+	}
+};
+
+// an OBJ index (1 based, negative counts back from the last one) to a 0 based one
+//
+bool objIndex(long index, size_t count, int& result) {
+	long i = index > 0 ? index - 1 : long(count) + index;
+	if (index == 0 || i < 0 || i >= long(count)) return false;
+	result = int(i);
+	return true;
+}
+
+bool loadObj(const MappedFile& file, vector<glm::vec3>& vertices, vector<glm::vec3>& normals, vector<uint32_t>& indices, string& error) {
+	vector<glm::vec3> positions, fileNormals;
+	vector<int> cornerPositions, cornerNormals;       // per triangle corner
+	vector<int> polygonPositions, polygonNormals;
+	bool allNormals = true;
+	TextCursor in = { file.data(), file.data() + file.size() };
+	int lineNum = 0;
+	for (; in.p < in.end; in.nextLine()) {
+		lineNum++;
+		in.skipSpace();
+		if (in.p + 1 >= in.end) continue;
+		bool ok = true;
+		if (in.p[0] == 'v' && (in.p[1] == ' ' || in.p[1] == '\t')) {
+			in.p++;
+			glm::vec3 v;
+			ok = in.number(v.x) && in.number(v.y) && in.number(v.z);
+			positions.push_back(v);
+		}
+		else if (in.p[0] == 'v' && in.p[1] == 'n') {
+			in.p += 2;
+			glm::vec3 n;
+			ok = in.number(n.x) && in.number(n.y) && in.number(n.z);
+			fileNormals.push_back(n);
+		}
+		else if (in.p[0] == 'f' && (in.p[1] == ' ' || in.p[1] == '\t')) {
+			// corners are v, v/vt, v//vn or v/vt/vn
+			//
+			in.p++;
+			polygonPositions.clear();
+			polygonNormals.clear();
+			while (ok && !in.atLineEnd()) {
+				long v, vn;
+				int position, normal = -1;
+				ok = in.integer(v) && objIndex(v, positions.size(), position);
+				if (ok && in.p < in.end && *in.p == '/') {
+					in.p++;
+					long vt;
+					if (in.p < in.end && *in.p != '/') ok = in.integer(vt);
+					if (ok && in.p < in.end && *in.p == '/') {
+						in.p++;
+						ok = in.integer(vn) && objIndex(vn, fileNormals.size(), normal);
+					}
+				}
+				polygonPositions.push_back(position);
+				polygonNormals.push_back(normal);
+				allNormals = allNormals && normal >= 0;
+			}
+			ok = ok && polygonPositions.size() >= 3;
+			for (int k = 2; ok && k < polygonPositions.size(); k++) {
+				for (int corner : { 0, k - 1, k }) {
+					cornerPositions.push_back(polygonPositions[corner]);
+					cornerNormals.push_back(polygonNormals[corner]);
+				}
+			}
+		}
+		if (!ok) {
+			error = "line " + ofToString(lineNum) + ": cannot read it";
+			return false;
+		}
+	}
+
+	// vertex normals need a vertex per position and normal pair
+	//
+	if (allNormals && !fileNormals.empty()) {
+		std::unordered_map<uint64_t, uint32_t> pairs;
+		for (int k = 0; k < cornerPositions.size(); k++) {
+			uint64_t key = (uint64_t(cornerPositions[k]) << 32) | uint32_t(cornerNormals[k]);
+			auto found = pairs.find(key);
+			if (found == pairs.end()) {
+				found = pairs.insert(std::make_pair(key, uint32_t(vertices.size()))).first;
+				vertices.push_back(positions[cornerPositions[k]]);
+				normals.push_back(fileNormals[cornerNormals[k]]);
+			}
+			indices.push_back(found->second);
+		}
+		return true;
+	}
+	vertices.swap(positions);
+	indices.assign(cornerPositions.begin(), cornerPositions.end());
+	return true;
+}
+
+// PLY:  a text header that lists the elements and their properties, then the data as
+// text or little or big endian binary
+//
+enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_UNKNOWN };
+
+PlyType plyType(const string& name) {
+	static const char* names[][2] = { { "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+		{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" } };
+	for (int t = 0; t < PLY_UNKNOWN; t++) {
+		if (name == names[t][0] || name == names[t][1]) return PlyType(t);
+	}
+	return PLY_UNKNOWN;
+}
+
+struct PlyProperty {
+	string name;
+	PlyType type;
+	PlyType countType = PLY_UNKNOWN;    // set for lists
+};
+
+struct PlyElement {
+	string name;
+	long count = 0;
+	vector<PlyProperty> properties;
+};
+
+struct PlyReader {
+	enum Format { ASCII, BINARY_LITTLE, BINARY_BIG } format = ASCII;
+	TextCursor in;
+	bool swap = false;
+
+	bool read(PlyType type, double& value) {
+		if (format == ASCII) return in.number(value);
+		static const int sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+		int size = sizes[type];
+		if (in.end - in.p < size) return false;
+		unsigned char bytes[8];
+		memcpy(bytes, in.p, size);
+		in.p += size;
+		if (swap) std::reverse(bytes, bytes + size);
+		switch (type) {
+		case PLY_INT8: value = *(int8_t*)bytes; break;
+		case PLY_UINT8: value = *(uint8_t*)bytes; break;
+		case PLY_INT16: { int16_t x; memcpy(&x, bytes, 2); value = x; break; }
+		case PLY_UINT16: { uint16_t x; memcpy(&x, bytes, 2); value = x; break; }
+		case PLY_INT32: { int32_t x; memcpy(&x, bytes, 4); value = x; break; }
+		case PLY_UINT32: { uint32_t x; memcpy(&x, bytes, 4); value = x; break; }
+		case PLY_FLOAT32: { float x; memcpy(&x, bytes, 4); value = x; break; }
+		default: { double x; memcpy(&x, bytes, 8); value = x; break; }
+		}
+		return true;
+	}
+};
+
+bool loadPly(const MappedFile& file, vector<glm::vec3>& vertices, vector<glm::vec3>& normals, vector<uint32_t>& indices, string& error) {
+	PlyReader reader;
+	reader.in = { file.data(), file.data() + file.size() };
+	TextCursor& in = reader.in;
+	if (in.word() != "ply") {
+		error = "not a PLY file";
+		return false;
+	}
+
+	vector<PlyElement> elements;
+	for (in.nextLine(); ; in.nextLine()) {
+		if (in.p >= in.end) {
+			error = "no end_header";
+			return false;
+		}
+		string keyword = in.word();
+		if (keyword == "end_header") break;
+		if (keyword == "format") {
+			string format = in.word();
+			if (format == "ascii") reader.format = PlyReader::ASCII;
+			else if (format == "binary_little_endian") reader.format = PlyReader::BINARY_LITTLE;
+			else if (format == "binary_big_endian") reader.format = PlyReader::BINARY_BIG;
+			else {
+				error = "unknown format " + format;
+				return false;
+			}
+		}
+		else if (keyword == "element") {
+			PlyElement element;
+			element.name = in.word();
+			if (!in.integer(element.count) || element.count < 0) {
+				error = "bad element " + element.name;
+				return false;
+			}
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty()) {
+			PlyProperty property;
+			string type = in.word();
+			if (type == "list") {
+				property.countType = plyType(in.word());
+				type = in.word();
+			}
+			property.type = plyType(type);
+			property.name = in.word();
+			if (property.type == PLY_UNKNOWN || (property.countType == PLY_UNKNOWN && type == "list")) {
+				error = "unknown type of property " + property.name;
+				return false;
+			}
+			elements.back().properties.push_back(property);
+		}
+	}
+	in.nextLine();
+	uint16_t one = 1;
+	bool littleEndianMachine = *(uint8_t*)&one == 1;
+	reader.swap = reader.format != PlyReader::ASCII && (reader.format == PlyReader::BINARY_LITTLE) != littleEndianMachine;
+
+	// vertices and faces are picked out by property name, anything else is read past
+	//
+	for (const PlyElement& element : elements) {
+		int x = -1, y = -1, z = -1, nx = -1, ny = -1, nz = -1, list = -1;
+		for (int i = 0; i < element.properties.size(); i++) {
+			const string& name = element.properties[i].name;
+			if (name == "x") x = i;
+			else if (name == "y") y = i;
+			else if (name == "z") z = i;
+			else if (name == "nx") nx = i;
+			else if (name == "ny") ny = i;
+			else if (name == "nz") nz = i;
+			else if ((name == "vertex_indices" || name == "vertex_index") && element.properties[i].countType != PLY_UNKNOWN) list = i;
+		}
+		bool isVertex = element.name == "vertex" && x >= 0 && y >= 0 && z >= 0;
+		bool hasNormals = isVertex && nx >= 0 && ny >= 0 && nz >= 0;
+		bool isFace = element.name == "face" && list >= 0;
+		if (isVertex) {
+			vertices.reserve(element.count);
+			if (hasNormals) normals.reserve(element.count);
+		}
+
+		vector<double> values(element.properties.size());
+		vector<uint32_t> polygon;
+		for (long record = 0; record < element.count; record++) {
+			for (int i = 0; i < element.properties.size(); i++) {
+				const PlyProperty& property = element.properties[i];
+				bool ok;
+				if (property.countType == PLY_UNKNOWN) ok = reader.read(property.type, values[i]);
+				else {
+					double count, index;
+					ok = reader.read(property.countType, count) && count >= 0;
+					if (i == list) polygon.clear();
+					for (long k = 0; ok && k < long(count); k++) {
+						ok = reader.read(property.type, index);
+						if (i == list) polygon.push_back(uint32_t(index));
+					}
+				}
+				if (!ok) {
+					error = element.name + " " + ofToString(int(record)) + ": cannot read it";
+					return false;
+				}
+			}
+			if (isVertex) {
+				vertices.push_back(glm::vec3(values[x], values[y], values[z]));
+				if (hasNormals) normals.push_back(glm::vec3(values[nx], values[ny], values[nz]));
+			}
+			if (isFace) {
+				for (int k = 2; k < polygon.size(); k++) {
+					indices.push_back(polygon[0]);
+					indices.push_back(polygon[k - 1]);
+					indices.push_back(polygon[k]);
+				}
+			}
+			if (reader.format == PlyReader::ASCII) in.nextLine();
+		}
+	}
+	return true;
+}
+
+}
+
+bool Mesh::load(const string& path, string& error) {
+	MappedFile mapped;
+	if (!mapped.open(path)) {
+		error = "cannot open " + path;
+		return false;
+	}
+	vector<glm::vec3> v, n;
+	vector<uint32_t> i;
+	string ext = ofToLower(ofFilePath::getFileExt(path));
+	bool loaded;
+	if (ext == "obj") loaded = loadObj(mapped, v, n, i, error);
+	else if (ext == "ply") loaded = loadPly(mapped, v, n, i, error);
+	else {
+		error = "not an .obj or .ply file";
+		loaded = false;
+	}
+	for (uint32_t index : i) {
+		if (loaded && index >= v.size()) {
+			error = "vertex index " + ofToString(int(index)) + " out of range";
+			loaded = false;
+		}
+	}
+	if (!loaded) {
+		error = path + ": " + error;
+		return false;
+	}
+	setTriangles(v, n, i);
+	file = path;
+	return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "scene.h"
+
+//  Triangle mesh
+//
+//  Loaded from OBJ or PLY into compact indexed buffers:  one position (and, if the file
+//  has them, one normal) per vertex and three vertex indices per triangle, all in
+//  object space.  The mesh is placed in the scene by position and a uniform scale, so
+//  moving it needs no rebuild.  Every mesh carries its own BVH over its triangles; the
+//  scene BVH only sees the mesh's box, and hands rays that reach it to intersect().
+//
+//  Triangles are tested with the watertight test of Woop, Benthin and Wald (2013), a
+//  Moller-Trumbore style edge function test done in a ray-aligned frame:  a ray
+//  through a shared edge or vertex always hits one of the triangles, so no background
+//  shows through the cracks of a closed model.
+//
+class Mesh : public SceneObject {
+public:
+	Mesh() { name = "mesh"; }
+
+	// load .obj or .ply (ascii or binary).  Polygons are split into triangle fans
+	//
+	bool load(const string& path, string& error);
+
+	// take over the buffers and build the BVH.  normals may be empty
+	//
+	void setTriangles(vector<glm::vec3>& vertices, vector<glm::vec3>& normals, vector<uint32_t>& indices);
+
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal);
+	bool intersectAny(const Ray& ray);
+	bool getBounds(AABB& bounds);
+	void draw();
+
+	int numTriangles() const { return indices.size() / 3; }
+	int numVertices() const { return vertices.size(); }
+
+	float scale = 1;
+	string file;                    // absolute path it was loaded from, for saving the scene
+
+private:
+	// a ray in object space, set up for the watertight test:  kz is the axis the ray
+	// runs along most, and the shear S takes its direction onto +z
+	//
+	struct TriangleRay {
+		glm::vec3 o, d;
+		int kx, ky, kz;
+		float sx, sy, sz;
+
+		TriangleRay(const Ray& ray, const glm::vec3& position, float scale);
+	};
+
+	bool hitTriangle(int tri, const TriangleRay& r, float tMax, float& t, float& b1, float& b2) const;
+	void build();
+
+	vector<glm::vec3> vertices;
+	vector<glm::vec3> normals;      // per vertex, empty for flat shading
+	vector<uint32_t> indices;       // three per triangle
+	BVH bvh;
+	AABB objectBounds;
+
+	unique_ptr<ofVboMesh> drawMesh;   // made on the first draw, so a move never copies it
+};
@@ -0,0 +1,91 @@
+#include "mipTexture.h"
+
+static int wrap(int x, int size) {
+	x %= size;
+	return x < 0 ? x + size : x;
+}
+
+void MipTexture::build(const ofPixels& pixels) {
+	levels.clear();
+	int w = pixels.getWidth(), h = pixels.getHeight();
+	if (w == 0 || h == 0) return;
+
+	// level 0 straight from the pixels, then halve until 1x1.  Odd sizes round down and
+	// the box wraps around the edge
+	//
+	vector<glm::vec4> linear(w * h);
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			ofColor c = pixels.getColor(x, y);
+			linear[y * w + x] = glm::vec4(c.r, c.g, c.b, c.a);
+		}
+	}
+
+	while (true) {
+		Level level;
+		level.width = w;
+		level.height = h;
+		level.tilesX = (w + 3) / 4;
+		level.data.assign(size_t(level.tilesX) * ((h + 3) / 4) * 16 * 4, 0);
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				const glm::vec4& c = linear[y * w + x];
+				unsigned char* p = &level.data[texelOffset(level, x, y)];
+				for (int k = 0; k < 4; k++) p[k] = (unsigned char)(c[k] + 0.5f);
+			}
+		}
+		levels.push_back(std::move(level));
+		if (w == 1 && h == 1) break;
+
+		int nextW = std::max(1, w / 2), nextH = std::max(1, h / 2);
+		vector<glm::vec4> next(nextW * nextH);
+		for (int y = 0; y < nextH; y++) {
+			for (int x = 0; x < nextW; x++) {
+				int x0 = wrap(2 * x, w), x1 = wrap(2 * x + 1, w);
+				int y0 = wrap(2 * y, h), y1 = wrap(2 * y + 1, h);
+				next[y * nextW + x] = 0.25f * (linear[y0 * w + x0] + linear[y0 * w + x1] + linear[y1 * w + x0] + linear[y1 * w + x1]);
+			}
+		}
+		linear.swap(next);
+		w = nextW;
+		h = nextH;
+	}
+}
+
+// bilinear lookup of one level, (s, t) in level 0 texels
+//
+glm::vec4 MipTexture::bilinear(int l, float s, float t) const {
+	const Level& level = levels[l];
+	if (l > 0) {
+		s = (s + 0.5f) * level.width / levels[0].width - 0.5f;
+		t = (t + 0.5f) * level.height / levels[0].height - 0.5f;
+	}
+	float fs = floorf(s), ft = floorf(t);
+	float a = s - fs, b = t - ft;
+	int x0 = wrap(int(fs), level.width), x1 = wrap(x0 + 1, level.width);
+	int y0 = wrap(int(ft), level.height), y1 = wrap(y0 + 1, level.height);
+
+	const unsigned char* p00 = &level.data[texelOffset(level, x0, y0)];
+	const unsigned char* p10 = &level.data[texelOffset(level, x1, y0)];
+	const unsigned char* p01 = &level.data[texelOffset(level, x0, y1)];
+	const unsigned char* p11 = &level.data[texelOffset(level, x1, y1)];
+	glm::vec4 c;
+	for (int k = 0; k < 4; k++) {
+		float top = p00[k] + a * (p10[k] - p00[k]);
+		float bottom = p01[k] + a * (p11[k] - p01[k]);
+		c[k] = top + b * (bottom - top);
+	}
+	return c;
+}
+
+glm::vec4 MipTexture::sample(float s, float t, float footprint) const {
+	if (levels.empty()) return glm::vec4(0, 0, 0, 1);
+
+	float lod = footprint > 1 ? log2f(footprint) : 0;
+	lod = std::min(lod, float(levels.size() - 1));
+	int l0 = int(lod);
+	float f = lod - l0;
+	glm::vec4 c = bilinear(l0, s, t);
+	if (f > 0 && l0 + 1 < levels.size()) c += f * (bilinear(l0 + 1, s, t) - c);
+	return c / 255.0f;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Mipmapped texture
+//
+//  A texture decoded once into 8 bit RGBA with its full mip chain (2x2 box filtered
+//  down to 1x1).  Each level is stored in 4x4 texel tiles, so the four texels of a
+//  bilinear lookup are almost always in the same 64 byte cache line.  Addressing wraps,
+//  the way the plane textures repeat.
+//
+//  Coordinates are in texels of level 0, with texel centers on whole numbers.
+//
+class MipTexture {
+public:
+	MipTexture() {}
+	explicit MipTexture(const ofPixels& pixels) { build(pixels); }
+
+	void build(const ofPixels& pixels);
+	bool isEmpty() const { return levels.empty(); }
+
+	int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+	int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+	int getNumLevels() const { return levels.size(); }
+
+	// one texel of level 0, as ofPixels::getColor would return it
+	//
+	ofColor texel(int x, int y) const { return fetch(levels[0], x, y); }
+
+	// trilinear lookup, RGBA scaled to 0..1 and not quantized again.  footprint is the
+	// size of the filtered area in level 0 texels; up to 1 texel this is a bilinear
+	// lookup of level 0
+	//
+	glm::vec4 sample(float s, float t, float footprint) const;
+
+private:
+	struct Level {
+		int width = 0, height = 0;
+		int tilesX = 0;
+		vector<unsigned char> data;      // RGBA, 4x4 texel tiles, rows of tiles
+	};
+
+	static ofColor fetch(const Level& level, int x, int y) {
+		const unsigned char* p = &level.data[texelOffset(level, x, y)];
+		return ofColor(p[0], p[1], p[2], p[3]);
+	}
+	static size_t texelOffset(const Level& level, int x, int y) {
+		return 4 * (size_t((y >> 2) * level.tilesX + (x >> 2)) * 16 + (y & 3) * 4 + (x & 3));
+	}
+	glm::vec4 bilinear(int level, float s, float t) const;
+
+	vector<Level> levels;
+};
@@ -6,71 +6,6 @@
 #include <typeinfo>
 #include <string>
 
-// Intersect Ray with Plane  (wrapper on glm::intersect*)
-//
-bool Plane::intersect(const Ray& ray, glm::vec3& point, glm::vec3&
-	normalAtIntersect) {
-	float dist;
-	bool insidePlane = false;
-	bool hit = glm::intersectRayPlane(ray.p, ray.d, position, this->normal,
-		dist);
-	if (hit) {
-		Ray r = ray;
-		point = r.evalPoint(dist);
-		normalAtIntersect = this->normal;
-		glm::vec2 xrange = glm::vec2(position.x - width / 2, position.x + width
-			/ 2);
-		glm::vec2 yrange = glm::vec2(position.y - width / 2, position.y + width
-			/ 2);
-		glm::vec2 zrange = glm::vec2(position.z - height / 2, position.z +
-			height / 2);
-		// horizontal 
-		//
-		if (normal == glm::vec3(0, 1, 0) || normal == glm::vec3(0, -1, 0)) {
-			if (point.x < xrange[1] && point.x > xrange[0] && point.z <
-				zrange[1] && point.z > zrange[0]) {
-				insidePlane = true;
-			}
-		}
-		// front or back
-		//
-		else if (normal == glm::vec3(0, 0, 1) || normal == glm::vec3(0, 0, -1))
-		{
-			if (point.x < xrange[1] && point.x > xrange[0] && point.y <
-				yrange[1] && point.y > yrange[0]) {
-				insidePlane = true;
-			}
-		}
-		// left or right
-		//
-		else if (normal == glm::vec3(1, 0, 0) || normal == glm::vec3(-1, 0, 0))
-		{
-			if (point.y < yrange[1] && point.y > yrange[0] && point.z <
-				zrange[1] && point.z > zrange[0]) {
-				insidePlane = true;
-			}
-		}
-	}
-	return insidePlane;
-}
-
-// Convert (u, v) to (x, y, z) 
-// We assume u,v is in [0, 1]
-//
-glm::vec3 ViewPlane::toWorld(float u, float v) {
-	float w = width();
-	float h = height();
-	return (glm::vec3((u * w) + min.x, (v * h) + min.y, position.z));
-}
-
-// Get a ray from the current camera position to the (u, v) position on
-// the ViewPlane
-//
-Ray RenderCam::getRay(float u, float v) {
-	glm::vec3 pointOnPlane = view.toWorld(u, v);
-	return(Ray(position, glm::normalize(pointOnPlane - position)));
-}
-
 //--------------------------------------------------------------
 void ofApp::setup(){
 	ofSetBackgroundColor(ofColor::black);
@@ -81,7 +16,23 @@ void ofApp::setup(){
 	gui.add(objColor.setup("Sphere Color", ofColor(100, 100, 140), ofColor(0, 0), ofColor(255, 255)));
 	gui.add(lightIntensity.setup("Light Intensity", 100.0f, 0.1f, 1000.0f));
 	gui.add(superSampleAmt.setup("Anti-Alias Sample Size", 2, 1, 8));
+	gui.add(ssaaFilterSlider.setup("SSAA Filter (Box/Tent/Lanczos)", ImagePyramid::BOX, ImagePyramid::BOX, ImagePyramid::LANCZOS));
+	gui.add(adaptiveThresholdSlider.setup("Adaptive AA Threshold", 0.002f, 0.0f, 0.05f));
 	gui.add(numTilesSlider.setup("Number of Tiles", 3, 1, 10));
+	gui.add(filterTexturesToggle.setup("Filter Textures", true));
+	gui.add(lightFalloffToggle.setup("Light Falloff", false));
+	gui.add(exposureSlider.setup("Exposure", 1.0f, 0.1f, 8.0f));
+	gui.add(reinhardToggle.setup("Compress Highlights", false));
+	gui.add(statsToggle.setup("Render Stats", false));
+	gui.add(livePreviewToggle.setup("Live Ray Trace", false));
+	gui.add(previewFrameTimeSlider.setup("Live Frame Time (ms)", 30.0f, 10.0f, 200.0f));
+	gui.add(numThreadsSlider.setup("Render Threads", ThreadPool::hardwareThreads(), 1, ThreadPool::hardwareThreads()));
+
+	// keep what the renders hit, so light and material edits can be shaded again (renders
+	// with too many samples for the G-buffer budget are traced again instead), and what
+	// each pixel shows, so objects can be picked on the image
+	progressive.setKeepGBuffer(true);
+	progressive.setKeepIds(true);
 
 	// main cam
 	mainCam.setDistance(13.0);
@@ -102,116 +53,105 @@ void ofApp::setup(){
 	// create an ofImage object for your target rendering image
 	image.allocate(imageWidth, imageHeight, ofImageType::OF_IMAGE_COLOR);
 
-	// texture application
-	ofImage texture;
-
-	/*Plane* groundPlane = new Plane(glm::vec3(0, -1, 0), glm::vec3(0, 1, 0), ofColor::aqua);
-	scene.push_back(groundPlane);
-	Plane* wallPlane = new Plane(glm::vec3(0, 0, -8), glm::vec3(0, 0, 1), ofColor::white);
-	scene.push_back(wallPlane);*/
+	ObjectHandle groundPlane = scene.add(Plane(glm::vec3(0, -1, 0), glm::vec3(0, 1, 0), ofColor::aqua));
+	scene.get(groundPlane)->loadTexture("cobble.jpg", "cobblespec.jpg"); // 1250x1250
 
-	Plane* groundPlane = new Plane(glm::vec3(0, -1, 0), glm::vec3(0, 1, 0), ofColor::aqua);
-	texture.load("cobble.jpg");
-	groundPlane->setTexture(texture); // 1250x1250
-	texture.load("cobblespec.jpg");
-	groundPlane->setSpec(texture);
-	scene.push_back(groundPlane);
-
-	Plane* wallPlane = new Plane(glm::vec3(0, 0, -8), glm::vec3(0, 0, 1), ofColor::white);
-	texture.load("green.jpg");
-	wallPlane->setTexture(texture);
-	texture.load("greenspec.jpg");
-	wallPlane->setSpec(texture);
-	scene.push_back(wallPlane);
+	ObjectHandle wallPlane = scene.add(Plane(glm::vec3(0, 0, -8), glm::vec3(0, 0, 1), ofColor::white));
+	scene.get(wallPlane)->loadTexture("green.jpg", "greenspec.jpg");
 
 	// the spheres
-	scene.push_back(new Sphere(glm::vec3(-3, 1, -5), 2.0f, ofColor::darkCyan));
-	scene.push_back(new Sphere(glm::vec3(4, 1, 0), 1.0f, ofColor::darkGreen));
-	scene.push_back(new Sphere(glm::vec3(0, 1, 0), 2.0f, ofColor::darkKhaki));
-	//scene.push_back(new Plane(glm::vec3(0, -1, 0), glm::vec3(0, 1, 0), ofColor::aqua));
-	//scene.push_back(new Plane(glm::vec3(0, 0, -8), glm::vec3(0, 0, 1), ofColor::white));
+	scene.add(Sphere(glm::vec3(-3, 1, -5), 2.0f, ofColor::darkCyan));
+	scene.add(Sphere(glm::vec3(4, 1, 0), 1.0f, ofColor::darkGreen));
+	scene.add(Sphere(glm::vec3(0, 1, 0), 2.0f, ofColor::darkKhaki));
 
-	sceneLights.push_back(new Light(glm::vec3(-5, 3, 3), 40.0f));
-	sceneLights.push_back(new Light(glm::vec3(0, 5, -1), 50.0f));
-	sceneLights.push_back(new Light(glm::vec3(3, 2, 5), 50.0f));
+	scene.add(Light(glm::vec3(-5, 3, 3), 40.0f));
+	scene.add(Light(glm::vec3(0, 5, -1), 50.0f));
+	scene.add(Light(glm::vec3(3, 2, 5), 50.0f));
 
 
 }
 
 //--------------------------------------------------------------
 void ofApp::update(){
-
+	// renders finish in the background; saving and the SSAA filter happen here
+	if (progressive.takeFinished()) {
+		if (renderJob == RENDER_FULL) finishRayTrace();
+		else if (renderJob == RENDER_MSAA) finishRayTraceMSAA();
+		renderJob = RENDER_NONE;
+	}
+	if (isLivePreview()) updateLivePreview();
 }
 
 // create a new sphere in the scene at the position of the mouse pointer
 //
 void ofApp::newSphere() {
-	Sphere* addSphere = new Sphere(mousePosition, .5);
-	scene.push_back(addSphere);
+	scene.add(Sphere(mousePosition, .5));
+}
+
+// add a model to the scene, sized to about 2 units across and centered on the origin
+//
+void ofApp::newMesh(const string& file) {
+	Mesh mesh;
+	string error;
+	if (!mesh.load(file, error)) {
+		cout << error << endl;
+		return;
+	}
+	AABB bounds;
+	if (mesh.getBounds(bounds)) {
+		glm::vec3 e = bounds.extent();
+		float size = std::max(e.x, std::max(e.y, e.z));
+		if (size > 0) mesh.scale = 2 / size;
+		mesh.position = -mesh.scale * bounds.center();
+	}
+	cout << "Loaded " << file << ", " << mesh.numTriangles() << " triangles" << endl;
+	scene.add(std::move(mesh));
 }
 
 // create a new light in the scene at the position of the mouse pointer
 //
 void ofApp::newLight() {
-	Light* addLight = new Light(mousePosition, 0.1f);
-	//scene.push_back(addLight);
-	sceneLights.push_back(addLight);
+	scene.add(Light(mousePosition, 0.1f));
 }
 
 // delete selected object in the scene
 //
 void ofApp::deleteObj() {
-	int i = 0;
-	bool found = false;
-	if (objSelected()) {
-		// if obj selected is a sphere
-		Light* selectedObj = dynamic_cast<Light*> (selected[0]);
-		if (selectedObj == nullptr) {
-			while (i < scene.size() && !found) {
-				if (selected[0] == scene[i]) {
-					found = true;
-				}
-				else
-					i++;
-			}
-			scene.erase(scene.begin() + i);
-		}
+	// the render in progress may still point at the object
+	progressive.cancel();
 
-		// if obj selected is a light
-		Light* selectedLight = dynamic_cast<Light*> (selected[0]);
-		if (selectedLight != nullptr) {
-			int j = 0;
-			found = false;
-			while (j < sceneLights.size() && !found) {
-				if (selected[0] == sceneLights[j]) {
-					found = true;
-				}
-				else
-					j++;
-			}
-			sceneLights.erase(sceneLights.begin() + j);
-		}
+	if (objSelected()) {
+		scene.remove(selected[0]);
+		selected.clear();
 	}
 }
 
 //--------------------------------------------------------------
 void ofApp::draw(){
 
-	
+	if (showRender) {
+		drawRender();
+		gui.draw();
+		return;
+	}
+	if (isLivePreview()) {
+		ofRectangle r = livePreviewRect();
+		livePreview.draw(r.x, r.y, r.width, r.height);
+		ofDrawBitmapString("live ray trace " + ofToString(livePreview.getWidth()) + "x" + ofToString(livePreview.getHeight()) + ", "
+			+ ofToString(livePreview.getSamplesPerAxis() * livePreview.getSamplesPerAxis()) + " samples per pixel, "
+			+ ofToString(livePreview.getFrameTime(), 1) + " ms", 10, ofGetHeight() - 10);
+		gui.draw();
+		return;
+	}
 
 	ofSetDepthTest(true);
 
 	theCam->begin();
 
-	for (int i = 0; i < scene.size(); i++) {
-		ofSetColor(scene[i]->diffuseColor);
-		scene[i]->draw();
-	}
-
-	for (int i = 0; i < sceneLights.size(); i++) {
-		ofSetColor(sceneLights[i]->diffuseColor);
-		sceneLights[i]->draw();
-	}
+	scene.forEach([](const ObjectHandle& h, SceneObject* obj) {
+		ofSetColor(obj->diffuseColor);
+		obj->draw();
+	});
 
 	theCam->end();
 	ofSetDepthTest(false);
@@ -219,167 +159,236 @@ void ofApp::draw(){
 	gui.draw();
 }
 
-// ray trace with multi sample anti aliasing
+// show the render in progress (or the last one), scaled to fit the window
 //
-void ofApp::rayTraceMSAA() {
-	MSAAImage.allocate(MSAAImageWidth, MSAAImageHeight, ofImageType::OF_IMAGE_COLOR);
-	// go through all pixels of the output image
-	for (int j = 0; j < MSAAImageHeight; j++) {
-		for (int i = 0; i < MSAAImageWidth; i++) {
-
-			// the distance between each ray vector
-			float samplingSplit = 1.0 / superSampleAmt;
-
-			// variables to average out the color per pixel
-			glm::vec3 colorSum = glm::vec3(0, 0, 0);
-			glm::vec3 theColorVec = glm::vec3(0, 0, 0);
-			glm::vec3 resultColorVec = glm::vec3(0, 0, 0);
-			ofColor resultColor;
-
-			// divide each pixel into samples
-			for (float xOffset = samplingSplit / 2; xOffset < 1.0; xOffset += samplingSplit) {
-				for (float yOffset = samplingSplit / 2; yOffset < 1.0; yOffset += samplingSplit) {
-					float u = (float(i) + xOffset) / float(MSAAImageWidth);
-					float v = (float(j) + yOffset) / float(MSAAImageHeight);
-
-					// ray trace
-					Ray theRay = renderCam.getRay(u, v);
-					float shortestDistance = std::numeric_limits<float>::infinity();
-					float currentDistance;
-					SceneObject* closestObj = NULL; // pointer
-					bool hitSurface = false;
-					ofColor objColor;
-					glm::vec3 intersectPoint, intersectNormal, closeIntersect, closeNormal;
-
-					for (int m = 0; m < scene.size(); m++) {
-						//cout << scene[m]->diffuseColor << " ";
-						//objColor = scene[m]->diffuseColor;
-
-						if (scene[m]->intersect(theRay, intersectPoint, intersectNormal)) {
-							hitSurface = true;
-							currentDistance = glm::distance(renderCam.position, intersectPoint);
-							if (currentDistance < shortestDistance) { // only use the color of the closest intersection
-								shortestDistance = currentDistance;
-								closeIntersect = intersectPoint;
-								closeNormal = intersectNormal;
-								closestObj = scene[m];
-							}
-						}
-					}
-
-					// if the ray does not hit an object
-					if (hitSurface == false) {
-						ofColor theColor = ofGetBackgroundColor();
-						theColorVec = glm::vec3(theColor.r, theColor.g, theColor.b);
-						colorSum = colorSum + theColorVec;
-					}
-					else { // the ray hits an object
-						if (closestObj->textured == true) { // if the object is textured
-							ofColor theColor;
-							glm::vec2 textureCoords;
-							glm::vec2 specCoords;
-							textureCoords = closestObj->getIJCoords(closeIntersect, numTilesSlider);
-							specCoords = closestObj->getIJCoordsSpec(closeIntersect, numTilesSlider);
-							ofColor textureColor;
-							ofColor specColor;
-
-							textureColor = closestObj->texture.getColor(textureCoords.x, textureCoords.y);
-							specColor = closestObj->specularTexture.getColor(specCoords.x, specCoords.y);
-							theColor = phong(closeIntersect, closeNormal, textureColor, specColor, 1000.0);
-							theColorVec = glm::vec3(theColor.r, theColor.g, theColor.b);
-							// add the color to colorSum
-							colorSum = colorSum + theColorVec;
-						}
-						else { // if the object is not textured
-
-							ofColor theColor;
-							theColor = phong(closeIntersect, closeNormal, closestObj->diffuseColor, closestObj->specularColor, 1000.0);
-							theColorVec = glm::vec3(theColor.r, theColor.g, theColor.b);
-							// add the color to colorSum
-							colorSum = colorSum + theColorVec;
-						}
-					}
-				}
-			}
-			// average out the colors
-			resultColorVec = colorSum / (superSampleAmt * superSampleAmt);
-			resultColor = ofColor(resultColorVec[0], resultColorVec[1], resultColorVec[2]);
-			MSAAImage.setColor(i, MSAAImageHeight - j - 1, resultColor);
-		}
+void ofApp::drawRender() {
+	if (progressive.fetch(renderPixels)) {
+		if (!renderTexture.isAllocated() || renderTexture.getWidth() != renderPixels.getWidth() || renderTexture.getHeight() != renderPixels.getHeight())
+			renderTexture.allocate(renderPixels);
+		renderTexture.loadData(renderPixels);
 	}
+	if (!renderTexture.isAllocated()) return;
+
+	ofRectangle r = renderRect();
+	ofSetColor(255);
+	renderTexture.draw(r.x, r.y, r.width, r.height);
+
+	string status;
+	if (progressive.isRunning())
+		status = "rendering pass " + ofToString(progressive.getPass() + 1) + " of " + ofToString(progressive.getNumPasses());
+	else
+		status = "press v to return to the scene";
+	ofDrawBitmapString(status, 10, ofGetHeight() - 10);
+}
 
-	MSAAImage.save("MSAA Render.jpg");
-	cout << "Multi-sample image done rendering" << endl;
+// compile the scene with the render settings of the gui, as seen through cam.  handles
+// gets the handle of every primitive's object, to pick objects from the image's ids
+//
+void ofApp::compileScene(RenderScene& target, const RenderCam& cam, vector<ObjectHandle>& handles) {
+	target.background = ofGetBackgroundColor();
+	target.numTiles = numTilesSlider;
+	target.filterTextures = filterTexturesToggle;
+	target.lightFalloff = lightFalloffToggle;
+	target.compile(scene.objects(), scene.lights(), cam);
+	handles.resize(target.primObject.size());
+	for (int i = 0; i < handles.size(); i++) handles[i] = scene.find(target.primObject[i]);
 }
 
-// ray trace with SSAA
+// the object a ray traced pixel shows, from the primitive in its id and the handles of
+// the scene it was traced from.  Null for background, objects deleted since and ones
+// that cannot be selected
 //
-void ofApp::rayTrace() {
+ObjectHandle ofApp::pickId(int prim, const vector<ObjectHandle>& handles) {
+	if (prim < 0 || prim >= handles.size()) return ObjectHandle();
+	SceneObject* obj = scene.get(handles[prim]);
+	return obj != nullptr && obj->isSelectable ? handles[prim] : ObjectHandle();
+}
 
-	// go through all pixels of output image
-	for (int j = 0; j < imageHeight; j++) { // row
-		for (int i = 0; i < imageWidth; i++) { // col
-
-			// one ray per pixel
-			float u = (float(i) + 0.5) / float(imageWidth); // pixel to image mapping // horizontal
-			float v = (float(j) + 0.5) / float(imageHeight); // vertical
-
-			Ray theRay = renderCam.getRay(u, v);
-			float shortestDistance = std::numeric_limits<float>::infinity();
-			float currentDistance;
-			SceneObject* closestObj = NULL; // pointer
-			bool hitSurface = false;
-			ofColor objColor;
-			glm::vec3 intersectPoint, intersectNormal, closeIntersect, closeNormal;
-
-			for (int m = 0; m < scene.size(); m++) {
-				//cout << scene[m]->diffuseColor << " ";
-				//objColor = scene[m]->diffuseColor;
-
-				if (scene[m]->intersect(theRay, intersectPoint, intersectNormal)) {
-					hitSurface = true;
-					currentDistance = glm::distance(renderCam.position, intersectPoint);
-					if (currentDistance < shortestDistance) { // only use the color of the closest intersection
-						shortestDistance = currentDistance;
-						closeIntersect = intersectPoint;
-						closeNormal = intersectNormal;
-						closestObj = scene[m];
-					}
-				}
-			}
-			if (hitSurface == false) { // if the ray does not intersect with an object
-				image.setColor(i, imageHeight - j - 1, ofGetBackgroundColor());
-			}
-			else { // if the ray intersects with an object
-				ofColor color;
-				if (closestObj->textured == true) { // if the object is textured
-					glm::vec2 textureCoords;
-					glm::vec2 specCoords;
-					textureCoords = closestObj->getIJCoords(closeIntersect, numTilesSlider);
-					specCoords = closestObj->getIJCoordsSpec(closeIntersect, numTilesSlider);
-					ofColor textureColor;
-					ofColor specColor;
-					textureColor = closestObj->texture.getColor(textureCoords.x, textureCoords.y);
-					specColor = closestObj->specularTexture.getColor(specCoords.x, specCoords.y);
-					color = phong(closeIntersect, closeNormal, textureColor, specColor, 1000.0);
-					image.setColor(i, imageHeight - j - 1, color);
-				}
-				else { // if the obj is not textured
-					color = closestObj->diffuseColor;
-					color = phong(closeIntersect, closeNormal, closestObj->diffuseColor, closestObj->specularColor, 1000.0);
-					image.setColor(i, imageHeight - j - 1, color);
-
-				}
-			}
-		}
+ToneMap ofApp::guiToneMap() {
+	ToneMap toneMap;
+	toneMap.exposure = exposureSlider;
+	toneMap.op = reinhardToggle ? ToneMap::REINHARD : ToneMap::CLAMP;
+	return toneMap;
+}
+
+// where the render goes in the window:  as big as it fits, centered
+//
+ofRectangle ofApp::renderRect() {
+	float scale = std::min(ofGetWidth() / renderTexture.getWidth(), ofGetHeight() / renderTexture.getHeight());
+	float w = renderTexture.getWidth() * scale;
+	float h = renderTexture.getHeight() * scale;
+	return ofRectangle((ofGetWidth() - w) / 2, (ofGetHeight() - h) / 2, w, h);
+}
+
+// where the live preview goes in the window:  all of it through previewCam, which
+// takes the window's shape, or the largest rectangle of the render's shape
+//
+ofRectangle ofApp::livePreviewRect() {
+	float w = ofGetWidth(), h = ofGetHeight();
+	if (theCam == &previewCam) return ofRectangle(0, 0, w, h);
+	float aspect = renderCam.view.getAspect();
+	float height = std::min(w / aspect, h);
+	return ofRectangle((w - height * aspect) / 2, (h - height) / 2, height * aspect, height);
+}
+
+// trace a frame of the live preview.  previewCam is turned into a RenderCam with its
+// field of view, on a view plane one unit in front of it.  The scene is only compiled
+// again when it or the settings compiled into it changed; the camera is all a moving
+// view needs.  The compile counts in the frame time the resolution adapts to
+//
+void ofApp::updateLivePreview() {
+	ofRectangle r = livePreviewRect();
+	RenderCam cam = renderCam;
+	if (theCam == &previewCam) {
+		glm::vec3 p = previewCam.getPosition();
+		float halfHeight = tan(glm::radians(previewCam.getFov()) / 2);
+		float halfWidth = halfHeight * r.width / r.height;
+		cam.position = p;
+		cam.view.position.z = p.z - 1;
+		cam.view.setSize(glm::vec2(p.x - halfWidth, p.y - halfHeight), glm::vec2(p.x + halfWidth, p.y + halfHeight));
+		cam.setOrientation(glm::mat3(previewCam.getXAxis(), previewCam.getYAxis(), previewCam.getZAxis()));
+	}
+	uint64_t start = ofGetElapsedTimeMicros();
+	if (scene.getVersion() != previewVersion || previewScene.background != ofGetBackgroundColor() ||
+		previewScene.filterTextures != filterTexturesToggle || previewScene.lightFalloff != lightFalloffToggle) {
+		compileScene(previewScene, cam, previewHandles);
+		previewVersion = scene.getVersion();
+	}
+	else previewScene.camera = cam;
+	float setupTime = (ofGetElapsedTimeMicros() - start) / 1000.0f;
+	renderPool.setNumThreads(numThreadsSlider);
+	livePreview.setTargetTime(previewFrameTimeSlider);
+	livePreview.render(previewScene, r.width, r.height, guiToneMap(), setupTime);
+}
+
+// compile the scene and capture everything the workers read from the gui before a
+// render starts
+//
+void ofApp::beginRender(int w, int h) {
+	progressive.cancel();
+	vector<ObjectHandle> lastHandles;
+	lastHandles.swap(renderHandles);
+	compileScene(renderScene, renderCam, renderHandles);
+
+	// the ids of the last render number the primitives of the last compile, and a render
+	// that keeps part of the image keeps them.  Adding or deleting an object shifts the
+	// numbers, so they are taken over to this compile's through the objects
+	//
+	std::unordered_map<const SceneObject*, int> primOf;
+	for (int i = 0; i < renderScene.primObject.size(); i++) {
+		if (renderScene.primObject[i] != nullptr) primOf[renderScene.primObject[i]] = i;
+	}
+	vector<int> idMap(lastHandles.size(), -1);
+	for (int i = 0; i < lastHandles.size(); i++) {
+		auto it = primOf.find(scene.get(lastHandles[i]));
+		if (it != primOf.end()) idMap[i] = it->second;
 	}
+	progressive.remapIds(idMap);
+	renderSampleAmt = superSampleAmt;
+	renderPool.setNumThreads(numThreadsSlider);
+
+	renderToneMap = guiToneMap();
+	progressive.setToneMap(renderToneMap);
+	progressive.setAdaptive(adaptiveThresholdSlider);
 
+	renderStatsOn = statsToggle;
+	if (renderStatsOn) renderStats.begin(renderPool.getNumThreads(), w, h, true);
+	progressive.setStats(renderStatsOn ? &renderStats : nullptr);
+}
+
+// start the render of the compiled scene.  If the last render was of the same size and
+// sampling, and the edits since then (objects dragged, added, deleted or recolored) only
+// touch part of the image, only that part is traced again and the rest is kept.  If they
+// only change how things are lit and colored (lights, materials, texture tiling), the
+// last render is shaded again without tracing, unless tracing the part they touch is
+// less work
+//
+void ofApp::startRender(int w, int h, int samplesPerAxis) {
+	SceneFootprint edited;
+	edited.capture(renderScene, renderHandles);
+	vector<Tile> dirty;
+	vector<char> retraceLights;
+	bool regions = renderFootprint.findDirtyRegions(edited, w, h, dirty);
+	int area = 0;
+	for (const Tile& r : dirty) area += r.width() * r.height();
+
+	if ((!regions || area > w * h / 4) && renderFootprint.canReshade(edited, retraceLights) &&
+		progressive.reshade(&renderScene, w, h, samplesPerAxis, retraceLights)) {
+		int moved = std::count(retraceLights.begin(), retraceLights.end(), 1);
+		cout << "Re-shading the last render (shadows of " << moved << " moved light" << (moved == 1 ? "" : "s") << " traced again)" << endl;
+	}
+	else if (regions && progressive.restart(&renderScene, w, h, samplesPerAxis, dirty, tileSize)) {
+		cout << "Re-rendering what changed since the last render (" << dirty.size() << " regions, "
+			<< ofToString(100.0 * area / (w * h), 1) << "% of the image before merging)" << endl;
+	}
+	else progressive.start(&renderScene, w, h, samplesPerAxis, tileSize);
+	renderFootprint = edited;
+}
+
+// record app thread work since start on the timeline of the render's statistics
+//
+void ofApp::statsEvent(const string& name, uint64_t start) {
+	if (renderStatsOn) renderStats.event(renderStats.getMainWorker(), name, start, renderStats.now());
+}
+
+void ofApp::writeRenderStats() {
+	if (!renderStatsOn) return;
+	RenderCounters total = renderStats.total();
+	bool written = renderStats.writeSummary("render_stats.json") && renderStats.writeTrace("render_trace.json")
+		&& renderStats.writeHeatmap("render_heatmap.png");
+	cout << "Render stats: " << total.primaryRays << " camera rays, " << total.shadowRays << " shadow rays, "
+		<< total.sphereTests + total.planeTests + total.otherTests << " primitive tests, " << total.boxTests << " box tests" << endl;
+	if (written)
+		cout << "Render stats, trace and heatmap written to " << ofToDataPath("render_stats.json") << " and next to it" << endl;
+	else
+		cout << "Could not write the render stats to " << ofToDataPath("") << endl;
+}
+
+// ray trace with multi sample anti aliasing.  The render runs in the background, and
+// finishRayTraceMSAA saves it once it is done
+//
+void ofApp::rayTraceMSAA() {
+	beginRender(MSAAImageWidth, MSAAImageHeight);
+	startRender(MSAAImageWidth, MSAAImageHeight, renderSampleAmt);
+	renderJob = RENDER_MSAA;
+	showRender = true;
+}
+
+void ofApp::finishRayTraceMSAA() {
+	MSAAImage.allocate(MSAAImageWidth, MSAAImageHeight, ofImageType::OF_IMAGE_COLOR);
+	progressive.fetch(renderPixels);
+	MSAAImage.setFromPixels(renderPixels);
+	uint64_t encodeStart = renderStats.now();
+	MSAAImage.save("MSAA Render.jpg");
+	statsEvent("encode", encodeStart);
+	cout << "Multi-sample image done rendering (" << progressive.getRenderTime() << " ms, first image after "
+		<< progressive.getFirstImageTime() << " ms, " << renderPool.getNumThreads() << " threads, "
+		<< ofToString(progressive.getSamplesTraced() / double(MSAAImageWidth * MSAAImageHeight), 2) << " samples per pixel)" << endl;
+	writeRenderStats();
+}
+
+// ray trace with SSAA.  The render runs in the background, finishRayTrace saves it and
+// applies the SSAA filter once it is done
+//
+void ofApp::rayTrace() {
+	beginRender(imageWidth, imageHeight);
+	startRender(imageWidth, imageHeight, 0);
+	renderJob = RENDER_FULL;
+	showRender = true;
+}
+
+void ofApp::finishRayTrace() {
+	progressive.fetch(renderPixels);
+	image.setFromPixels(renderPixels);
+	uint64_t encodeStart = renderStats.now();
 	image.save("Full Render.jpg");
-	cout << "Original image done rendering" << endl;
+	statsEvent("encode", encodeStart);
+	cout << "Original image done rendering (" << progressive.getRenderTime() << " ms, first image after "
+		<< progressive.getFirstImageTime() << " ms, " << renderPool.getNumThreads() << " threads)" << endl;
 
 	// check if SS anti aliasing is allowed with the chosen sample size
 	bool antiAliasAllowed = false;
-	float superSampleFl = (float)superSampleAmt;
+	float superSampleFl = (float)renderSampleAmt;
 	if ((fmod(imageWidth, superSampleFl)) == 0 && (fmod(imageHeight, superSampleFl) == 0))
 		antiAliasAllowed = true;
 
@@ -389,66 +398,56 @@ void ofApp::rayTrace() {
 	else {
 		cout << "Anti-alias render not allowed.  The original image is " << imageWidth << "x" << imageHeight << ".  Pick a super sample size that divides the size evenly." << endl;
 		cout << endl;
+		writeRenderStats();
 		return;
 	}
 
-	// set image height and width of image with AA
-	// with SSAA, the new image height and width is smaller than the original
-	AAImageHeight = imageHeight / superSampleAmt;
-	AAImageWidth = imageWidth / superSampleAmt;
-	AAImage.allocate(AAImageWidth, AAImageHeight, ofImageType::OF_IMAGE_COLOR);
-
-	// Super Sample Anti Aliasing
-	int sampleNum = superSampleAmt;
-	for (int j = 0; j < AAImageHeight; j++) { // row
-		for (int i = 0; i < AAImageWidth; i++) { // col
-			glm::vec3 colorSum = glm::vec3(0, 0, 0);
-			glm::vec3 theColorVec = glm::vec3(0, 0, 0);
-			glm::vec3 resultColorVec = glm::vec3(0, 0, 0);
-			ofColor resultColor;
-
-			// for every sample size x sample size pixels in the original render, the colors are averaged out into one pixel in the new SSAA image.
-			for (int v = 0; v < sampleNum; v++) {
-				for (int u = 0; u < sampleNum; u++) {
-					ofColor theColor = image.getColor(i * sampleNum + fmod(u, sampleNum), j * sampleNum + fmod(v, sampleNum));
-					theColorVec = glm::vec3(theColor.r, theColor.g, theColor.b);
-
-					// add up colors
-					colorSum = colorSum + theColorVec;
-				}
-			}
-
-			resultColorVec = colorSum / (sampleNum * sampleNum);
-			resultColor = ofColor(resultColorVec[0], resultColorVec[1], resultColorVec[2]);
-			AAImage.setColor(i, j, resultColor);
-		}
-	}
-
+	// every reduction the SSAA filter can step through, in one pass over the float
+	// render.  The first one is the SSAA image
+	//
+	uint64_t pyramidStart = ofGetElapsedTimeMillis();
+	uint64_t resampleStart = renderStats.now();
+	aaPyramid.build(progressive.getFrameBuffer(), renderSampleAmt, (ImagePyramid::Filter)(int)ssaaFilterSlider);
+	statsEvent("resample", resampleStart);
+	cout << "SSAA pyramid of " << aaPyramid.getNumLevels() << " levels built (" << ofGetElapsedTimeMillis() - pyramidStart << " ms)" << endl;
+
+	const FrameBuffer& aaLevel = aaPyramid.getLevel(1);
+	AAImageWidth = aaLevel.getWidth();
+	AAImageHeight = aaLevel.getHeight();
+	aaLevel.resolve(AAImage.getPixels(), renderToneMap);
+	AAImage.update();
+
+	encodeStart = renderStats.now();
 	AAImage.save("SSAA Render x1.jpg");
+	statsEvent("encode", encodeStart);
 	aaRenderNum = 2; // reset the number of times SSAA has been applied to the current render
 	cout << "Supersample anti-aliasing image done rendering" << endl;
 
 	// make full size image from super sample image
 	// not really needed, just here to showcase how the image size decreases with each render of the SSAA filter which is why it is so expensive
+	// each SSAA pixel covers a sampleNum x sampleNum block, so each row is built once
+	// and copied to the rows of its block
+	//
+	int sampleNum = renderSampleAmt;
+	ofPixels& expanded = image.getPixels();
+	const ofPixels& aaPixels = AAImage.getPixels();
 	for (int j = 0; j < imageHeight; j++) {
+		unsigned char* dst = expanded.getData() + size_t(j) * imageWidth * 3;
+		if (j % sampleNum != 0) {
+			memcpy(dst, dst - imageWidth * 3, imageWidth * 3);
+			continue;
+		}
+		const unsigned char* src = aaPixels.getData() + size_t(std::min(j / sampleNum, AAImageHeight - 1)) * AAImageWidth * 3;
 		for (int i = 0; i < imageWidth; i++) {
-
-			for (int b = 0; b < sampleNum; b++) {
-				for (int a = 0; a < sampleNum; a++) {
-
-					float u;
-					float v;
-					u = (int)ofMap(i, 0.0, imageWidth, 0.0, AAImageWidth);
-					v = (int)ofMap(j, 0.0, imageHeight, 0.0, AAImageHeight);
-
-					ofColor theColor = AAImage.getColor(u, v);
-					image.setColor(i, j, theColor);
-				}
-			}
+			memcpy(dst + 3 * i, src + 3 * std::min(i / sampleNum, AAImageWidth - 1), 3);
 		}
 	}
+	image.update();
+	encodeStart = renderStats.now();
 	image.save("SSAA Render Expanded.jpg");
+	statsEvent("encode", encodeStart);
 	cout << "SSAA render expanded image done rendering" << endl;
+	writeRenderStats();
 	
 	cout << endl;
 
@@ -464,34 +463,17 @@ void ofApp::reSSAntiAlias() {
 		return;
 	}
 
-	// Super Sample Anti Aliasing
-	int sampleNum = superSampleAmt;
-	reAAImageHeight = AAImageHeight / sampleNum;
-	reAAImageWidth = AAImageWidth / sampleNum;
-	reAAImage.allocate(reAAImageWidth, reAAImageHeight, ofImageType::OF_IMAGE_COLOR);
-	for (int j = 0; j < reAAImageHeight; j++) { // row
-		for (int i = 0; i < reAAImageWidth; i++) { // col
-			glm::vec3 colorSum = glm::vec3(0, 0, 0);
-			glm::vec3 theColorVec = glm::vec3(0, 0, 0);
-			glm::vec3 resultColorVec = glm::vec3(0, 0, 0);
-			ofColor resultColor;
-
-			for (int v = 0; v < sampleNum; v++) {
-				for (int u = 0; u < sampleNum; u++) {
-
-					ofColor theColor = AAImage.getColor(i * sampleNum + fmod(u, sampleNum), j * sampleNum + fmod(v, sampleNum));
-					theColorVec = glm::vec3(theColor.r, theColor.g, theColor.b);
-
-					// add up colors
-					colorSum = colorSum + theColorVec;
-				}
-			}
-
-			resultColorVec = colorSum / (sampleNum * sampleNum);
-			resultColor = ofColor(resultColorVec[0], resultColorVec[1], resultColorVec[2]);
-			reAAImage.setColor(i, j, resultColor);
-		}
+	// the pyramid already has every reduction, by the sample size of the render
+	if (aaRenderNum > aaPyramid.getNumLevels()) {
+		cout << "The anti-alias render cannot be reduced any further" << endl;
+		return;
 	}
+	const FrameBuffer& aaLevel = aaPyramid.getLevel(aaRenderNum);
+	reAAImageWidth = aaLevel.getWidth();
+	reAAImageHeight = aaLevel.getHeight();
+	aaLevel.resolve(reAAImage.getPixels(), renderToneMap);
+	reAAImage.update();
+
 	string aaRenderNumString = to_string(aaRenderNum);
 	string aaImageOutput = "SSAA Render x" + aaRenderNumString + ".jpg";
 	reAAImage.save(aaImageOutput);
@@ -516,7 +498,7 @@ ofColor ofApp::lambert(const glm::vec3& p, const glm::vec3& norm, const ofColor
 	ofColor ambient = 0.3f * diffuse * 2.0f;
 	theLambert = ambient;
 
-	for (auto light : sceneLights) {
+	for (auto light : scene.lights()) {
 		glm::vec3 n = glm::normalize(norm);
 		glm::vec3 l = glm::normalize(light->position - p);
 		glm::vec3 r = light->position - p;
@@ -529,46 +511,15 @@ ofColor ofApp::lambert(const glm::vec3& p, const glm::vec3& norm, const ofColor
 
 }
 
+// shading and shadow tests run on the compiled scene (see RenderScene), so these only
+// see the scene as of the last beginRender()
+//
 ofColor ofApp::phong(const glm::vec3& p, const glm::vec3& norm, const ofColor diffuse, const ofColor specular, float power) {
-	//ofColor color = ofColor::black;
-	ofColor ambient = 0.3f * diffuse * 1.0f;
-	ofColor color = ambient;
-	// for each pixel, loop through all the lights, add up values from phong function for light value of pixel
-	// if pixel is in a shadow, color is black
-
-	for (auto light : sceneLights) {
-		glm::vec3 n = glm::normalize(norm);
-		glm::vec3 l = glm::normalize(light->position - p);
-		glm::vec3 v = glm::normalize(renderCam.position - p);
-		glm::vec3 h = glm::normalize((v + l) / glm::length(v + l));
-		glm::vec3 r = light->position - p;
-		ofColor theLambert, thePhong;
-		glm::vec3 intersectPoint, intersectNormal;
-		//float r = glm::length(l);
-
-		if (!inShadow(Ray(p, l))) {
-			// function from slides and textbook
-			theLambert = diffuse * light->intensity / glm::pow(r.length(), 2) * glm::max(0.0f, glm::dot(n, l));
-			thePhong = specular * light->intensity / glm::pow(r.length(), 2) * glm::max(0.0f, glm::pow(glm::dot(n, h), power));
-			color += (theLambert + thePhong);
-		}
-	}
-	return color;
+	return quantizeColor(renderScene.phong(p, norm, linearColor(diffuse), linearColor(specular), power));
 }
 
 bool ofApp::inShadow(const Ray& theRay) {
-	float eps = .01; // offset
-	for (auto obj : scene) {
-
-		Plane* thePlane = dynamic_cast<Plane*> (obj);
-		if (thePlane == nullptr) {
-			glm::vec3 point, normal;
-			if (obj->intersect(Ray(theRay.p + theRay.d * eps, theRay.d), point, normal))
-				return true;
-		}
-
-	}
-	return false;
+	return renderScene.inShadow(theRay);
 }
 
 // Pressing Keys
@@ -597,9 +548,23 @@ void ofApp::keyPressed(int key) {
 		break;
 	case '1':
 		theCam = &mainCam;
+		showRender = false;
 		break;
 	case '2':
 		theCam = &previewCam;
+		showRender = false;
+		break;
+	case 'v':
+		showRender = !showRender;
+		break;
+	case 'p':
+		livePreviewToggle = !livePreviewToggle;
+		break;
+	case 'w':
+		saveScene("scene.txt");
+		break;
+	case 'e':
+		exportRender("Render.exr");
 		break;
 	case 'c':
 		if (mainCam.getMouseInputEnabled()) mainCam.disableMouseInput();
@@ -625,9 +590,14 @@ void ofApp::mouseMoved(int x, int y) {
 //--------------------------------------------------------------
 void ofApp::mouseDragged(int x, int y, int button){
 	if (objSelected() && bDrag) {
+		// meshes and instances are traced through their live transforms, so a render
+		// in progress must stop before one moves
+		//
+		progressive.cancel();
 		glm::vec3 point;
 		mouseToDragPlane(x, y, point);
-		selected[0]->position += (point - lastPoint);
+		selectedObject()->position += (point - lastPoint);
+		scene.touch();
 		lastPoint = point;
 	}
 }
@@ -637,17 +607,18 @@ void ofApp::mouseDragged(int x, int y, int button){
 //  If no object selected, the plane passing through the world origin is used.
 //
 bool ofApp::mouseToDragPlane(int x, int y, glm::vec3& point) {
-	glm::vec3 p = theCam->screenToWorld(glm::vec3(x, y, 0));
-	glm::vec3 d = p - theCam->getPosition();
-	glm::vec3 dn = glm::normalize(d);
+	Ray ray = mouseRay(x, y);
+	glm::vec3 p = ray.p;
+	glm::vec3 dn = ray.d;
 
 	float dist;
 	glm::vec3 pos;
 	if (objSelected()) {
-		pos = selected[0]->position;
+		pos = selectedObject()->position;
 	}
 	else pos = glm::vec3(0, 0, 0);
-	if (glm::intersectRayPlane(p, dn, pos, glm::normalize(theCam->getZAxis()), dist)) {
+	glm::vec3 axis = isLivePreview() && theCam != &previewCam ? glm::vec3(0, 0, 1) : glm::normalize(theCam->getZAxis());
+	if (glm::intersectRayPlane(p, dn, pos, axis, dist)) {
 		point = p + dn * dist;
 		return true;
 	}
@@ -655,6 +626,18 @@ bool ofApp::mouseToDragPlane(int x, int y, glm::vec3& point) {
 	return false;
 }
 
+// the ray through window point (x, y) of whatever is on screen:  the view of the current
+// camera, or renderCam's while the live preview shows it
+//
+Ray ofApp::mouseRay(int x, int y) {
+	if (isLivePreview() && theCam != &previewCam) {
+		ofRectangle r = livePreviewRect();
+		return renderCam.getRay((x - r.x) / r.width, 1 - (y - r.y) / r.height);
+	}
+	glm::vec3 p = theCam->screenToWorld(glm::vec3(x, y, 0));
+	return Ray(p, glm::normalize(p - theCam->getPosition()));
+}
+
 //--------------------------------------------------------------
 //
 // Provides functionality of single selection and if something is already selected,
@@ -669,72 +652,96 @@ void ofApp::mousePressed(int x, int y, int button) {
 	//
 	selected.clear();
 
+	// on a finished render, select what the pixel shows.  There is nothing to drag there
+	//
+	if (showRender) {
+		if (progressive.isRunning() || !renderTexture.isAllocated()) return;
+		ofRectangle r = renderRect();
+		int i = (x - r.x) / r.width * renderTexture.getWidth();
+		int j = (y - r.y) / r.height * renderTexture.getHeight();
+		ObjectHandle h = pickId(progressive.getId(i, j), renderHandles);
+		if (!h.isNull()) {
+			selected.push_back(h);
+			cout << "selected obj position: " << scene.get(h)->position << endl;
+		}
+		return;
+	}
+
 	//
 	// test if something selected
 	//
-	vector<SceneObject*> hits;
+	vector<ObjectHandle> hits;
 
-	glm::vec3 p = theCam->screenToWorld(glm::vec3(x, y, 0));
-	glm::vec3 d = p - theCam->getPosition();
-	glm::vec3 dn = glm::normalize(d);
+	Ray ray = mouseRay(x, y);
+	glm::vec3 p = ray.p;
+	glm::vec3 dn = ray.d;
 
-	// check for selection of scene objects
+	// the live preview's last frame has the front-most surface under the mouse in its
+	// ids, which costs the same however big the scene is.  Lights are not traced into
+	// it, so they are still tested with the ray (there are only a few), and win only
+	// when they are nearer than that surface, which the ray is tested with again for
+	// its distance.  Without a traced frame every object is tested
 	//
-	for (int i = 0; i < scene.size(); i++) {
-
+	bool traced = isLivePreview() && livePreview.getWidth() > 0;
+	if (traced) {
+		ofRectangle r = livePreviewRect();
+		int prim = livePreview.getId((x - r.x) / r.width, (y - r.y) / r.height);
+		float nearest = std::numeric_limits<float>::infinity();
 		glm::vec3 point, norm;
-
-		//  We hit an object
-		//
-		if (scene[i]->isSelectable && scene[i]->intersect(Ray(p, dn), point, norm)) {
-			hits.push_back(scene[i]);
+		if (prim >= 0 && prim < previewHandles.size() && scene.get(previewHandles[prim]) != nullptr &&
+			previewScene.intersectPrim(prim, Ray(p, dn), point, norm)) {
+			nearest = glm::length(point - p);
 		}
-	}
-
-	// check for selection of scene objects
-	//
-	for (int i = 0; i < sceneLights.size(); i++) {
-
-		glm::vec3 point, norm;
-
-		//  We hit an object
-		//
-		if (sceneLights[i]->isSelectable && sceneLights[i]->intersect(Ray(p, dn), point, norm)) {
-			hits.push_back(sceneLights[i]);
+		ObjectHandle light;
+		for (Light* l : scene.lights()) {
+			if (l->isSelectable && l->intersect(Ray(p, dn), point, norm) && glm::length(point - p) < nearest) {
+				nearest = glm::length(point - p);
+				light = scene.find(l);
+			}
 		}
+		ObjectHandle h = light.isNull() ? pickId(prim, previewHandles) : light;
+		if (!h.isNull()) hits.push_back(h);
 	}
+	else {
+		// check for selection of scene objects and lights
+		//
+		scene.forEach([&](const ObjectHandle& h, SceneObject* obj) {
+			glm::vec3 point, norm;
 
+			//  We hit an object
+			//
+			if (obj->isSelectable && obj->intersect(Ray(p, dn), point, norm)) {
+				hits.push_back(h);
+			}
+		});
+	}
 
 	// if we selected more than one, pick nearest
 	//
-	SceneObject* selectedObj = NULL;
 	if (hits.size() > 0) {
-		selectedObj = hits[0];
+		selected.push_back(hits[0]);
 		float nearestDist = std::numeric_limits<float>::infinity();
 		for (int n = 0; n < hits.size(); n++) {
-			float dist = glm::length(hits[n]->position - theCam->getPosition());
+			float dist = glm::length(scene.get(hits[n])->position - p);
 			if (dist < nearestDist) {
 				nearestDist = dist;
-				selectedObj = hits[n];
+				selected[0] = hits[n];
 			}
 		}
 	}
 
+	SceneObject* selectedObj = selectedObject();
 	if (selectedObj) {
-		selected.push_back(selectedObj);
-
-		// if the selected object is a sphere
-		Sphere* selectedSphere = dynamic_cast<Sphere*> (selectedObj);
-		if (selectedSphere != nullptr) {
+		// the handle says what type the object is
+		if (selected[0].type == ObjectHandle::SPHERE) {
+			Sphere* selectedSphere = static_cast<Sphere*>(selectedObj);
 			selectedSphere->radius = sphereRadius;
 			selectedSphere->diffuseColor = objColor;
 		}
-
-		// if the selected object is a light
-		Light* selectedLight = dynamic_cast<Light*> (selectedObj);
-		if (selectedLight != nullptr) {
-			selectedLight->intensity = lightIntensity;
+		if (selected[0].type == ObjectHandle::LIGHT) {
+			static_cast<Light*>(selectedObj)->intensity = lightIntensity;
 		}
+		scene.touch();
 
 		bDrag = true;
 		mouseToDragPlane(x, y, lastPoint);
@@ -771,6 +778,68 @@ void ofApp::gotMessage(ofMessage msg){
 }
 
 //--------------------------------------------------------------
+// dropping a scene file (text or binary) on the window replaces the scene
+//
 void ofApp::dragEvent(ofDragInfo dragInfo){ 
+	if (dragInfo.files.empty()) return;
+	string ext = ofToLower(ofFilePath::getFileExt(dragInfo.files[0]));
+	if (ext == "obj" || ext == "ply") newMesh(dragInfo.files[0]);
+	else loadScene(dragInfo.files[0]);
+}
+
+// write the scene, with the render settings that affect the image, for the batch renderer
+//
+void ofApp::saveScene(const string& file) {
+	SceneDescription desc;
+	desc.objects = scene.objects();
+	desc.lights = scene.lights();
+	desc.camera = renderCam;
+	desc.background = ofGetBackgroundColor();
+	desc.numTiles = numTilesSlider;
+	if (saveSceneFile(ofToDataPath(file), desc))
+		cout << "Scene saved to " << ofToDataPath(file) << endl;
+	else
+		cout << "Could not save the scene to " << ofToDataPath(file) << endl;
+}
+
+// write the last render as a float image, before tonemapping
+//
+void ofApp::exportRender(const string& file) {
+	if (progressive.isRunning() || !progressive.getFrameBuffer().isAllocated()) {
+		cout << "Nothing to export.  Export the render once it has finished" << endl;
+		return;
+	}
+	if (progressive.getFrameBuffer().save(file))
+		cout << "Render exported to " << ofToDataPath(file) << endl;
+	else
+		cout << "Could not export the render to " << ofToDataPath(file) << endl;
+}
 
+void ofApp::loadScene(const string& file) {
+	SceneDescription desc;
+	string error;
+	if (isBinarySceneFile(file)) {
+		RenderScene loaded;
+		if (!loadBinaryScene(file, loaded, error, false)) {
+			cout << error << endl;
+			return;
+		}
+		describeScene(loaded, desc);
+	}
+	else if (!loadSceneFile(file, desc, error)) {
+		cout << error << endl;
+		desc.clear();
+		return;
+	}
+
+	progressive.cancel();
+	selected.clear();
+	scene.clear();
+	for (SceneObject* obj : desc.objects) scene.adopt(obj);
+	for (Light* light : desc.lights) scene.adopt(light);
+	renderCam = desc.camera;
+	previewCam.setPosition(renderCam.position);
+	ofSetBackgroundColor(desc.background);
+	numTilesSlider = desc.numTiles;
+	cout << "Scene loaded from " << file << endl;
 }
@@ -0,0 +1,549 @@
+#include "progressiveRenderer.h"
+
+// the coarse passes, from the first (blockiest) one down.  The tile size is a multiple
+// of the largest block, so blocks never straddle two tiles
+//
+static const int coarseStrides[] = { 16, 8, 4, 2 };
+static const int numCoarseStrides = 4;
+
+// how often the image in progress is handed to the UI while a pass is running
+//
+static const uint64_t publishInterval = 50;
+
+// adaptive sampling:  samples every pixel gets in the first pass
+//
+static const int adaptiveFirstSamples = 4;
+
+static float radicalInverse(int i, int base) {
+	float inverse = 1.0f / base, result = 0, digit = inverse;
+	for (; i > 0; i /= base, digit *= inverse) result += (i % base) * digit;
+	return result;
+}
+
+// the cells of an n x n grid in the order the points of the Halton (2, 3) sequence
+// first land in them, so that any number of leading samples is spread over the whole
+// pixel.  Cell (x, y) is index x * n + y, as in sampleOffsets
+//
+static std::vector<int> spreadOrder(int n) {
+	std::vector<int> order;
+	std::vector<char> taken(n * n, 0);
+	for (int i = 0; order.size() < n * n && i < 64 * n * n; i++) {
+		int cell = int(radicalInverse(i, 2) * n) * n + int(radicalInverse(i, 3) * n);
+		if (!taken[cell]) {
+			taken[cell] = 1;
+			order.push_back(cell);
+		}
+	}
+	for (int cell = 0; cell < n * n; cell++) {
+		if (!taken[cell]) order.push_back(cell);
+	}
+	return order;
+}
+
+static float luma(const glm::vec3& c) {
+	return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+}
+
+void ProgressiveRenderer::start(const RenderScene* scene, int w, int h, int samplesPerAxis, int tileSize) {
+	start(scene, w, h, samplesPerAxis, std::vector<Tile>{ Tile{ 0, 0, w, h } }, tileSize);
+}
+
+void ProgressiveRenderer::start(const RenderScene* scene, int w, int h, int samplesPerAxis, const std::vector<Tile>& regions, int tileSize) {
+	cancel();
+
+	this->scene = scene;
+	width = w;
+	height = h;
+	this->samplesPerAxis = samplesPerAxis;
+	this->tileSize = tileSize;
+	imageHeight = bandImageHeight > 0 ? bandImageHeight : h;
+	rowOffset = bandImageHeight > 0 ? bandImageHeight - bandFirstRow - h : 0;
+	staleTiles.assign(makeTiles(w, h, tileSize).size(), 0);
+	selectTiles(regions);
+
+	// same sample positions, in the same order, as the loops in rayTraceMSAA
+	//
+	sampleOffsets.clear();
+	if (samplesPerAxis > 0) {
+		float samplingSplit = 1.0 / samplesPerAxis;
+		for (float xOffset = samplingSplit / 2; xOffset < 1.0; xOffset += samplingSplit) {
+			for (float yOffset = samplingSplit / 2; yOffset < 1.0; yOffset += samplingSplit) {
+				sampleOffsets.push_back(glm::vec2(xOffset, yOffset));
+			}
+		}
+	}
+	int numSamples = sampleOffsets.size();
+	renderedThreshold = adaptiveThreshold;
+	adaptive = adaptiveThreshold > 0 && numSamples > adaptiveFirstSamples;
+	if (adaptive) sampleOrder = spreadOrder(samplesPerAxis);
+
+	back.allocate(w, h);
+	back.clear(linearColor(scene->background));
+	lumaSquares.assign(adaptive ? w * h : 0, 0.0f);
+	noisy.assign(adaptive ? w * h : 0, 1);
+	active.assign(adaptive ? w * h : 0, 1);
+	{
+		std::lock_guard<std::mutex> lock(frontMutex);
+		back.resolve(front, toneMap);
+		frontToneMap = toneMap;
+		frontChanged = true;
+	}
+
+	// a slot per sample, marked empty until it is traced
+	//
+	int slots = samplesPerAxis > 0 ? numSamples : 1;
+	if (keepGBuffer && scene->lightPosition.size() <= GSample::maxLights && size_t(w) * h * slots * sizeof(GSample) <= gbufferBudget) {
+		GSample empty;
+		empty.prim = GSample::noSample;
+		gbuffer.assign(size_t(w) * h * slots, empty);
+		gbufferSlots = slots;
+	}
+	else {
+		gbuffer.clear();
+		gbuffer.shrink_to_fit();
+		gbufferSlots = 0;
+	}
+	gbufferValid = false;
+	if (keepIds) ids.assign(size_t(w) * h, -1);
+	else {
+		ids.clear();
+		ids.shrink_to_fit();
+	}
+
+	partial = tiles.size() < staleTiles.size();
+	reshading = false;
+	launch();
+}
+
+bool ProgressiveRenderer::restart(const RenderScene* scene, int w, int h, int samplesPerAxis, const std::vector<Tile>& regions, int tileSize) {
+	cancel();
+	if (!back.isAllocated() || w != width || h != height || samplesPerAxis != this->samplesPerAxis ||
+		tileSize != this->tileSize || adaptiveThreshold != renderedThreshold) return false;
+	this->scene = scene;
+
+	selectTiles(regions);
+
+	// every pass starts a pixel over with set(), so the stale pixels need no clearing.
+	// Adaptive passes only look at the pixels of these tiles, and may leave some of their
+	// G-buffer slots empty this time
+	//
+	if (adaptive) {
+		std::fill(noisy.begin(), noisy.end(), 0);
+		std::fill(active.begin(), active.end(), 0);
+		for (const Tile& tile : tiles) {
+			for (int j = tile.y0; j < tile.y1; j++) {
+				int y = height - j - 1;
+				std::fill(&noisy[y * width + tile.x0], &noisy[y * width + tile.x1], 1);
+				std::fill(&active[y * width + tile.x0], &active[y * width + tile.x1], 1);
+				for (int i = tile.x0; i < tile.x1 && gbufferSlots > 0; i++) {
+					for (int k = 0; k < gbufferSlots; k++) gsample(i, y, k).prim = GSample::noSample;
+				}
+			}
+		}
+	}
+	if (!(toneMap == frontToneMap)) {
+		std::lock_guard<std::mutex> lock(frontMutex);
+		back.resolve(front, toneMap);
+		frontToneMap = toneMap;
+		frontChanged = true;
+	}
+	gbufferValid = false;
+	partial = true;
+	reshading = false;
+	launch();
+	return true;
+}
+
+bool ProgressiveRenderer::reshade(const RenderScene* scene, int w, int h, int samplesPerAxis, const std::vector<char>& retraceLights) {
+	cancel();
+	if (!gbufferValid || w != width || h != height || samplesPerAxis != this->samplesPerAxis || adaptiveThreshold != renderedThreshold ||
+		retraceLights.size() != scene->lightPosition.size() || retraceLights.size() > GSample::maxLights) return false;
+
+	// a cancelled reshade may have left the light bits of some tiles for the lights it
+	// retraced as they were before, so those lights are traced again too
+	//
+	std::vector<char> retrace = retraceLights;
+	if (reshading && std::find(staleTiles.begin(), staleTiles.end(), 1) != staleTiles.end()) {
+		for (int i = 0; i < retrace.size() && i < this->retraceLights.size(); i++) retrace[i] |= this->retraceLights[i];
+	}
+	this->retraceLights = retrace;
+
+	this->scene = scene;
+	tiles = makeTiles(w, h, tileSize);
+	if (!(toneMap == frontToneMap)) {
+		std::lock_guard<std::mutex> lock(frontMutex);
+		back.resolve(front, toneMap);
+		frontToneMap = toneMap;
+		frontChanged = true;
+	}
+	staleTiles.assign(tiles.size(), 1);
+	partial = false;
+	reshading = true;
+	launch();
+	return true;
+}
+
+int ProgressiveRenderer::bandMargin(int samplesPerAxis) const {
+	int numSamples = samplesPerAxis * samplesPerAxis;
+	if (adaptiveThreshold <= 0 || numSamples <= adaptiveFirstSamples) return 0;
+	int refinements = 0;
+	for (int taken = adaptiveFirstSamples; taken < numSamples; taken *= 2) refinements++;
+	return refinements;
+}
+
+// the float image, the tonemapped copy handed to the UI, the adaptive pixel state, the
+// G-buffer slots and the ids
+//
+size_t ProgressiveRenderer::bytesPerPixel(int samplesPerAxis) const {
+	size_t bytes = 4 * sizeof(float) + 3;
+	if (keepIds) bytes += sizeof(int);
+	if (adaptiveThreshold > 0 && samplesPerAxis * samplesPerAxis > adaptiveFirstSamples) bytes += sizeof(float) + 2;
+	if (keepGBuffer) bytes += sizeof(GSample) * std::max(1, samplesPerAxis * samplesPerAxis);
+	return bytes;
+}
+
+void ProgressiveRenderer::remapIds(const std::vector<int>& map) {
+	for (int& id : ids) id = id >= 0 && id < map.size() ? map[id] : -1;
+}
+
+// the tiles the regions touch join the ones still stale from a cancelled render, and
+// become the tiles to trace
+//
+void ProgressiveRenderer::selectTiles(const std::vector<Tile>& regions) {
+	std::vector<Tile> grid = makeTiles(width, height, tileSize);
+	int columns = (width + tileSize - 1) / tileSize;
+	for (const Tile& r : regions) {
+		for (int ty = r.y0 / tileSize; ty <= (r.y1 - 1) / tileSize; ty++) {
+			for (int tx = r.x0 / tileSize; tx <= (r.x1 - 1) / tileSize; tx++) staleTiles[ty * columns + tx] = 1;
+		}
+	}
+	tiles.clear();
+	for (int k = 0; k < grid.size(); k++) {
+		if (staleTiles[k]) tiles.push_back(grid[k]);
+	}
+}
+
+// count the passes and start the render thread on the tiles that are set up
+//
+void ProgressiveRenderer::launch() {
+	int numSamples = sampleOffsets.size();
+	int samplePasses = samplesPerAxis > 0 ? numSamples : 1;
+	if (adaptive) {
+		samplePasses = 1;
+		for (int taken = adaptiveFirstSamples; taken < numSamples; taken *= 2) samplePasses++;
+	}
+	numPasses = reshading ? 1 : (coarsePasses ? numCoarseStrides : 0) + samplePasses;
+	shadowCaches.assign(pool.getNumThreads(), ShadowCache());
+
+	pass = 0;
+	firstImageTime = renderTime = 0;
+	samplesTraced = 0;
+	startTime = lastPublish = ofGetElapsedTimeMillis();
+	cancelled = false;
+	finished = false;
+	running = true;
+	thread = std::thread(&ProgressiveRenderer::run, this);
+}
+
+void ProgressiveRenderer::cancel() {
+	cancelled = true;
+	wait();
+}
+
+void ProgressiveRenderer::wait() {
+	if (thread.joinable()) thread.join();
+}
+
+bool ProgressiveRenderer::fetch(ofPixels& pixels) {
+	std::lock_guard<std::mutex> lock(frontMutex);
+	if (!frontChanged) return false;
+	pixels = front;
+	frontChanged = false;
+	return true;
+}
+
+void ProgressiveRenderer::publish() {
+	std::lock_guard<std::mutex> lock(frontMutex);
+	if (partial) {
+		for (const Tile& tile : tiles) back.resolve(front, toneMap, tile.x0, height - tile.y1, tile.x1, height - tile.y0);
+	}
+	else back.resolve(front, toneMap);
+	frontChanged = true;
+	lastPublish = ofGetElapsedTimeMillis();
+}
+
+void ProgressiveRenderer::run() {
+	if (reshading)
+		runPass("reshade", [&](const Tile& tile, int worker) { reshadeTile(tile, worker); });
+	else
+		tracePasses();
+
+	if (!cancelled) {
+		std::fill(staleTiles.begin(), staleTiles.end(), 0);
+		if (!reshading) gbufferValid = gbufferSlots > 0;
+		renderTime = ofGetElapsedTimeMillis() - startTime;
+		finished = true;
+	}
+	running = false;
+}
+
+void ProgressiveRenderer::tracePasses() {
+	for (int i = 0; i < numCoarseStrides && coarsePasses && !cancelled; i++) {
+		runPass("coarse " + ofToString(coarseStrides[i]), [&](const Tile& tile, int worker) { tracePixels(tile, worker, coarseStrides[i], i > 0); });
+	}
+
+	if (adaptive) {
+		int numSamples = sampleOffsets.size();
+		runPass("samples 0-" + ofToString(adaptiveFirstSamples), [&](const Tile& tile, int worker) { addSampleRange(tile, worker, 0, adaptiveFirstSamples, false); });
+		for (int first = adaptiveFirstSamples; first < numSamples && !cancelled; first *= 2) {
+			uint64_t start = stats != nullptr ? stats->now() : 0;
+			findNoisyPixels();
+			if (stats != nullptr) stats->event(0, "find noisy pixels", start, stats->now());
+			int last = std::min(2 * first, numSamples);
+			runPass("samples " + ofToString(first) + "-" + ofToString(last), [&](const Tile& tile, int worker) { addSampleRange(tile, worker, first, last, true); });
+		}
+	}
+	else if (samplesPerAxis > 0) {
+		for (int s = 0; s < sampleOffsets.size() && !cancelled; s++) {
+			runPass("sample " + ofToString(s), [&](const Tile& tile, int worker) { addSamples(tile, worker, s); });
+		}
+	}
+	else if (!cancelled) {
+		runPass("full", [&](const Tile& tile, int worker) { tracePixels(tile, worker, 1, coarsePasses); });
+	}
+}
+
+// run one pass over all tiles.  The tiles go to the pool in batches so the image can be
+// published in between while nobody is writing to it
+//
+void ProgressiveRenderer::runPass(const string& name, const std::function<void(const Tile&, int)>& renderTile) {
+	int batchSize = std::max(8, 4 * pool.getNumThreads());
+	for (int first = 0; first < tiles.size() && !cancelled; first += batchSize) {
+		int count = std::min(batchSize, (int)tiles.size() - first);
+		pool.parallelFor(count, [&](int i, int worker) {
+			if (cancelled) return;
+			uint64_t start = stats != nullptr ? stats->now() : 0;
+			renderTile(tiles[first + i], worker);
+			if (stats != nullptr) stats->event(worker, name, start, stats->now());
+		});
+		if (ofGetElapsedTimeMillis() - lastPublish >= publishInterval) publish();
+	}
+	if (!cancelled) {
+		publish();
+		if (pass++ == 0) firstImageTime = ofGetElapsedTimeMillis() - startTime;
+	}
+}
+
+// trace samples on the scene, counting them into the worker's statistics if there are
+// any.  cost gets the nanoseconds of each sample when there is a heatmap, gsamples what
+// they hit when there is a G-buffer, and prims the primitives when there are ids
+//
+void ProgressiveRenderer::traceSamples(int worker, const std::vector<float>& u, const std::vector<float>& v, float du, float dv,
+	std::vector<glm::vec3>& colors, std::vector<float>& cost, std::vector<GSample>& gsamples, std::vector<int>& prims) {
+	colors.resize(u.size());
+	GSample* hits = nullptr;
+	if (gbufferSlots > 0) {
+		gsamples.resize(u.size());
+		hits = gsamples.data();
+	}
+	int* hitPrims = nullptr;
+	if (!ids.empty()) {
+		prims.resize(u.size());
+		hitPrims = prims.data();
+	}
+	RenderCounters* counters = stats != nullptr ? &stats->counters(worker) : nullptr;
+	float* costs = nullptr;
+	if (stats != nullptr && stats->pixelCost() != nullptr) {
+		cost.resize(u.size());
+		costs = cost.data();
+	}
+	scene->traceSamples(u.data(), v.data(), u.size(), du, dv, colors.data(), counters, costs, hits, hitPrims, &shadowCaches[worker]);
+	samplesTraced += u.size();
+}
+
+// charge cost to pixel (i, j) of the tiles.  The heatmap is flipped like the
+// framebuffer, so it comes out the right way up
+//
+void ProgressiveRenderer::addCost(int i, int j, float cost) {
+	float* costs = stats != nullptr ? stats->pixelCost() : nullptr;
+	if (costs != nullptr) costs[(height - j - 1) * width + i] += cost;
+}
+
+// trace the pixel centers on a grid of the given stride and fill each stride x stride
+// block with its color.  With skipTraced, pixels that a coarser pass already traced
+// (both coordinates multiples of 2 * stride) are left alone.  Each sample is final for
+// its own pixel, so its textures are filtered over that pixel, not the block
+//
+void ProgressiveRenderer::tracePixels(const Tile& tile, int worker, int stride, bool skipTraced) {
+	std::vector<float> u, v, cost;
+	std::vector<int> column, prims;
+	std::vector<glm::vec3> colors;
+	std::vector<GSample> gsamples;
+	int first = (tile.x0 + stride - 1) / stride * stride;
+
+	for (int j = (tile.y0 + stride - 1) / stride * stride; j < tile.y1; j += stride) {
+		bool oddRow = (j % (2 * stride)) != 0;
+		u.clear();
+		v.clear();
+		column.clear();
+		for (int i = first; i < tile.x1; i += stride) {
+			if (skipTraced && !oddRow && (i % (2 * stride)) == 0) continue;
+			u.push_back((float(i) + 0.5) / float(width)); // pixel to image mapping, as in rayTrace
+			v.push_back((float(j + rowOffset) + 0.5) / float(imageHeight));
+			column.push_back(i);
+		}
+		traceSamples(worker, u, v, 1.0f / width, 1.0f / imageHeight, colors, cost, gsamples, prims);
+
+		for (int k = 0; k < column.size(); k++) {
+			if (!cost.empty()) addCost(column[k], j, cost[k]);
+			if (!gsamples.empty()) gsample(column[k], height - j - 1, 0) = gsamples[k];
+			for (int y = j; y < std::min(j + stride, tile.y1); y++) {
+				for (int x = column[k]; x < std::min(column[k] + stride, tile.x1); x++) {
+					back.set(x, height - y - 1, colors[k]);
+					if (!prims.empty()) ids[size_t(height - y - 1) * width + x] = prims[k];
+				}
+			}
+		}
+	}
+}
+
+// add sample number s of the grid to every pixel of the tile.  The first sample
+// replaces what the coarse passes left there
+//
+void ProgressiveRenderer::addSamples(const Tile& tile, int worker, int s) {
+	std::vector<float> u(tile.width()), v(tile.width()), cost;
+	std::vector<glm::vec3> colors(tile.width());
+	std::vector<GSample> gsamples;
+	std::vector<int> prims;
+
+	for (int j = tile.y0; j < tile.y1; j++) {
+		for (int i = tile.x0; i < tile.x1; i++) {
+			u[i - tile.x0] = (float(i) + sampleOffsets[s].x) / float(width);
+			v[i - tile.x0] = (float(j + rowOffset) + sampleOffsets[s].y) / float(imageHeight);
+		}
+		traceSamples(worker, u, v, 1.0f / (width * samplesPerAxis), 1.0f / (imageHeight * samplesPerAxis), colors, cost, gsamples, prims);
+
+		for (int i = tile.x0; i < tile.x1; i++) {
+			if (!cost.empty()) addCost(i, j, cost[i - tile.x0]);
+			if (!gsamples.empty()) gsample(i, height - j - 1, s) = gsamples[i - tile.x0];
+			if (s == 0) back.set(i, height - j - 1, colors[i - tile.x0]);
+			else back.add(i, height - j - 1, colors[i - tile.x0]);
+			if (s == 0 && !prims.empty()) ids[size_t(height - j - 1) * width + i] = prims[i - tile.x0];
+		}
+	}
+}
+
+// add samples [first, last) of sampleOrder to the pixels of the tile, or with onlyNoisy
+// just to the active ones.  Keeps the luminance squares for findNoisyPixels
+//
+void ProgressiveRenderer::addSampleRange(const Tile& tile, int worker, int first, int last, bool onlyNoisy) {
+	std::vector<float> u, v, cost;
+	std::vector<int> column, prims;
+	std::vector<glm::vec3> colors;
+	std::vector<GSample> gsamples;
+
+	for (int j = tile.y0; j < tile.y1; j++) {
+		int y = height - j - 1;
+		column.clear();
+		for (int i = tile.x0; i < tile.x1; i++) {
+			if (!onlyNoisy || active[y * width + i]) column.push_back(i);
+		}
+		if (column.empty()) continue;
+
+		u.clear();
+		v.clear();
+		for (int s = first; s < last; s++) {
+			const glm::vec2& offset = sampleOffsets[sampleOrder[s]];
+			for (int i : column) {
+				u.push_back((float(i) + offset.x) / float(width));
+				v.push_back((float(j + rowOffset) + offset.y) / float(imageHeight));
+			}
+		}
+		traceSamples(worker, u, v, 1.0f / (width * samplesPerAxis), 1.0f / (imageHeight * samplesPerAxis), colors, cost, gsamples, prims);
+
+		for (int s = first, k = 0; s < last; s++) {
+			for (int i : column) {
+				if (!cost.empty()) addCost(i, j, cost[k]);
+				if (!gsamples.empty()) gsample(i, y, s) = gsamples[k];
+				if (s == 0 && !prims.empty()) ids[size_t(y) * width + i] = prims[k];
+				const glm::vec3& color = colors[k++];
+				if (s == 0) back.set(i, y, color);
+				else back.add(i, y, color);
+				float l = luma(color);
+				lumaSquares[y * width + i] = (s == 0 ? 0 : lumaSquares[y * width + i]) + l * l;
+			}
+		}
+	}
+}
+
+// shade every sample of the tile's pixels again from the G-buffer, at the positions and
+// in the order they were traced in, so the sums come out as a render would make them
+//
+void ProgressiveRenderer::reshadeTile(const Tile& tile, int worker) {
+	std::vector<float> u, v;
+	std::vector<glm::vec3> colors;
+	RenderCounters* counters = stats != nullptr ? &stats->counters(worker) : nullptr;
+	int n = gbufferSlots;
+	float du = samplesPerAxis > 0 ? 1.0f / (width * samplesPerAxis) : 1.0f / width;
+	float dv = samplesPerAxis > 0 ? 1.0f / (imageHeight * samplesPerAxis) : 1.0f / imageHeight;
+
+	for (int j = tile.y0; j < tile.y1; j++) {
+		int y = height - j - 1;
+		u.clear();
+		v.clear();
+		for (int i = tile.x0; i < tile.x1; i++) {
+			for (int k = 0; k < n; k++) {
+				if (samplesPerAxis == 0) {
+					u.push_back((float(i) + 0.5) / float(width));
+					v.push_back((float(j + rowOffset) + 0.5) / float(imageHeight));
+				}
+				else {
+					const glm::vec2& offset = sampleOffsets[adaptive ? sampleOrder[k] : k];
+					u.push_back((float(i) + offset.x) / float(width));
+					v.push_back((float(j + rowOffset) + offset.y) / float(imageHeight));
+				}
+			}
+		}
+		colors.resize(u.size());
+		GSample* samples = &gsample(tile.x0, y, 0);
+		scene->reshadeSamples(u.data(), v.data(), u.size(), du, dv, samples, retraceLights.data(), colors.data(), counters, &shadowCaches[worker]);
+
+		for (int i = tile.x0, k = 0; i < tile.x1; i++) {
+			bool first = true;
+			for (int s = 0; s < n; s++, k++) {
+				if (samples[k].prim == GSample::noSample) continue;
+				if (first) back.set(i, y, colors[k]);
+				else back.add(i, y, colors[k]);
+				first = false;
+			}
+		}
+	}
+}
+
+// mark the pixels whose mean is still uncertain:  the standard error of the luminance
+// over the samples so far is above the threshold.  A pixel stays active if any of its
+// neighbours is noisy, which catches thin edges the first samples of a pixel missed
+//
+void ProgressiveRenderer::findNoisyPixels() {
+	pool.parallelFor(height, [&](int y, int worker) {
+		for (int x = 0; x < width; x++) {
+			int i = y * width + x;
+			if (!active[i]) continue;    // no new samples, nothing changed
+			float n = back.getSamples(x, y);
+			float mean = luma(back.getColor(x, y));
+			float variance = std::max(0.0f, lumaSquares[i] / n - mean * mean) * n / (n - 1);
+			noisy[i] = variance / n > adaptiveThreshold * adaptiveThreshold;
+		}
+	});
+	pool.parallelFor(height, [&](int y, int worker) {
+		for (int x = 0; x < width; x++) {
+			bool any = false;
+			for (int dy = std::max(0, y - 1); dy <= std::min(height - 1, y + 1) && !any; dy++) {
+				for (int dx = std::max(0, x - 1); dx <= std::min(width - 1, x + 1) && !any; dx++) {
+					any = noisy[dy * width + dx] != 0;
+				}
+			}
+			active[y * width + x] = any;
+		}
+	});
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "renderScene.h"
+#include "tileRenderer.h"
+
+//  Progressive renderer
+//
+//  Renders a RenderScene on a background thread (using the tile pool for the actual
+//  tracing) so the app stays responsive, and refines the image pass by pass:
+//
+//    - coarse passes trace one pixel in every 16x16, 8x8, 4x4 and 2x2 block and fill
+//      the block with it, so a recognisable image is there within a few milliseconds
+//    - the full pass traces the pixels that are still missing.  With one sample per
+//      pixel the image is now final, and every pixel has been traced exactly once
+//    - on a sample grid, sample passes then add one sample of the regular
+//      n x n grid to every pixel at a time, and the pixels show the running average.
+//      After the last pass they hold exactly the average of the whole grid
+//    - with an adaptive threshold, the grid is instead visited in a well spread order
+//      (see setAdaptive).  The first pass takes a few samples of every pixel, later
+//      passes double the samples of the pixels that are still noisy, up to the whole
+//      grid, and leave the others alone
+//
+//  Samples accumulate in a float framebuffer.  The image in progress is tonemapped from
+//  it and handed to the UI thread through fetch(); the float image itself is there
+//  once the render has finished.
+//
+//  With a G-buffer, every sample also keeps what it hit (see GSample), and a finished
+//  image can be shaded again from it in a single pass, without tracing a camera ray.
+//  It costs 32 bytes per sample.
+//
+class ProgressiveRenderer {
+public:
+	ProgressiveRenderer(ThreadPool& pool) : pool(pool) {}
+	~ProgressiveRenderer() { cancel(); }
+
+	// start rendering a w x h image of the scene.  samplesPerAxis = 0 traces one ray
+	// through each pixel center like rayTrace, n >= 1 the n x n grid of rayTraceMSAA.
+	// The scene must stay untouched until the render has finished or been cancelled
+	//
+	void start(const RenderScene* scene, int w, int h, int samplesPerAxis, int tileSize = 32);
+
+	// the same for only the tiles the regions touch (tile coordinates, see restart), the
+	// rest of the image is left background.  With no regions it just sets up an image
+	// for restart() to render piece by piece
+	//
+	void start(const RenderScene* scene, int w, int h, int samplesPerAxis, const std::vector<Tile>& regions, int tileSize = 32);
+
+	// render only the pixels in regions (tile coordinates, see SceneFootprint) again, on
+	// top of the last image, for a scene that differs from the last one only there.
+	// Tiles a cancelled render left unfinished are traced again too.  Returns false and
+	// renders nothing if the last image was of a different size or sampling
+	//
+	bool restart(const RenderScene* scene, int w, int h, int samplesPerAxis, const std::vector<Tile>& regions, int tileSize = 32);
+
+	// shade the last image again from the G-buffer, for a scene that differs from the last
+	// one only in what reshadeSamples allows.  Shadow rays are traced again for the lights
+	// retraceLights flags, one entry per light.  Returns false and renders nothing without
+	// a G-buffer of a finished image of the same size and sampling.  Adaptive pixels keep
+	// the samples they had
+	//
+	bool reshade(const RenderScene* scene, int w, int h, int samplesPerAxis, const std::vector<char>& retraceLights);
+	void cancel();
+	void wait();
+
+	// without coarse passes every pixel is traced once, straight into the final image.
+	// For renders nobody watches
+	//
+	void setCoarsePasses(bool coarse) { coarsePasses = coarse; }
+
+	// make the next start() render just a band of a taller image:  its h rows are rows
+	// [firstRow, firstRow + h) of an image imageHeight high, counted from the top like
+	// the framebuffer.  Every sample lands where it would in the whole image, so bands
+	// put together make the same image.  imageHeight = 0 goes back to whole images
+	//
+	void setBand(int imageHeight, int firstRow) { bandImageHeight = imageHeight; bandFirstRow = firstRow; }
+
+	// rows a band must be rendered with above and below its own so they come out as in
+	// the whole image.  Adaptive sampling looks at the neighbours of a pixel, and how far
+	// that reaches grows by a row every refinement pass
+	//
+	int bandMargin(int samplesPerAxis) const;
+
+	// bytes the renderer holds per pixel of the image it renders
+	//
+	size_t bytesPerPixel(int samplesPerAxis) const;
+
+	// keep a G-buffer of the renders from the next start() on, for reshade().  Scenes with
+	// more than GSample::maxLights lights get none, and so do renders whose G-buffer would
+	// take more than the budget (32 bytes a sample:  a 1200 x 800 image with 8 x 8 samples
+	// would need 2 GB)
+	//
+	void setKeepGBuffer(bool keep) { keepGBuffer = keep; }
+	void setGBufferBudget(size_t bytes) { gbufferBudget = bytes; }
+
+	// keep the primitive each pixel shows from the next start() on:  the one its first
+	// sample hit, for picking objects on the image.  4 bytes per pixel
+	//
+	void setKeepIds(bool keep) { keepIds = keep; }
+
+	// renumber the ids of the last image:  primitive i becomes map[i], and -1 if map
+	// does not have it.  restart() and reshade() keep the ids of the pixels they do not
+	// trace, so when the scene they get numbers its primitives differently, this has to
+	// be called first.  Only while nothing is rendering
+	//
+	void remapIds(const std::vector<int>& map);
+
+	bool isRunning() const { return running; }
+	bool takeFinished() { return finished.exchange(false); }   // true once per completed render
+
+	// adaptive anti aliasing on a sample grid:  a pixel gets more samples while the
+	// standard error of its luminance (0..1) or a neighbour's is above threshold.  0
+	// takes every sample of the grid everywhere.  Set it before start()
+	//
+	void setAdaptive(float threshold) { adaptiveThreshold = threshold; }
+	float getAdaptive() const { return adaptiveThreshold; }
+
+	// how the float image is turned into the 8 bit one fetch() returns.  Set it before
+	// start()
+	//
+	void setToneMap(const ToneMap& toneMap) { this->toneMap = toneMap; }
+	const ToneMap& getToneMap() const { return toneMap; }
+
+	// collect statistics of the renders into stats, or nothing with null.  Every tile
+	// becomes an event named after its pass.  stats must have been begun for the pool's
+	// threads and the image size, and stay untouched until the render is over
+	//
+	void setStats(RenderStats* stats) { this->stats = stats; }
+
+	// copy the image into pixels if it changed since the last fetch
+	//
+	bool fetch(ofPixels& pixels);
+
+	// the float image.  Only read it while nothing is rendering
+	//
+	const FrameBuffer& getFrameBuffer() const { return back; }
+
+	// the primitive pixel (x, y) of the framebuffer shows, -1 for background or without
+	// ids.  Only read it while nothing is rendering
+	//
+	int getId(int x, int y) const { return ids.empty() || x < 0 || y < 0 || x >= width || y >= height ? -1 : ids[size_t(y) * width + x]; }
+
+	int getPass() const { return pass; }
+	int getNumPasses() const { return numPasses; }
+	uint64_t getFirstImageTime() const { return firstImageTime; }  // ms from start to the first image
+	uint64_t getRenderTime() const { return renderTime; }          // ms from start to the final image
+	uint64_t getSamplesTraced() const { return samplesTraced; }    // camera rays of the last render
+
+private:
+	void selectTiles(const std::vector<Tile>& regions);
+	void launch();
+	void run();
+	void tracePasses();
+	void runPass(const string& name, const std::function<void(const Tile&, int)>& renderTile);
+	void traceSamples(int worker, const std::vector<float>& u, const std::vector<float>& v, float du, float dv,
+		std::vector<glm::vec3>& colors, std::vector<float>& cost, std::vector<GSample>& gsamples, std::vector<int>& prims);
+	void addCost(int i, int j, float cost);
+	GSample& gsample(int x, int y, int slot) { return gbuffer[(size_t(y) * width + x) * gbufferSlots + slot]; }
+	void tracePixels(const Tile& tile, int worker, int stride, bool skipTraced);
+	void addSamples(const Tile& tile, int worker, int sample);
+	void addSampleRange(const Tile& tile, int worker, int first, int last, bool onlyNoisy);
+	void reshadeTile(const Tile& tile, int worker);
+	void findNoisyPixels();
+	void publish();
+
+	ThreadPool& pool;
+	const RenderScene* scene = nullptr;
+	int width = 0, height = 0;
+	int samplesPerAxis = 0;
+	int tileSize = 32;
+	int bandImageHeight = 0, bandFirstRow = 0;
+	int imageHeight = 0;                  // of the whole image the samples are placed in
+	int rowOffset = 0;                    // tile row 0 is this row of it, from the bottom
+	bool coarsePasses = true;
+	float adaptiveThreshold = 0;
+	ToneMap toneMap;
+	RenderStats* stats = nullptr;
+	std::vector<Tile> tiles;              // what this render traces:  all of them, or the stale ones
+	std::vector<char> staleTiles;         // per tile of the image, not finished for the last scene
+	bool partial = false;                 // a restart(), only the tiles are published
+	float renderedThreshold = 0;
+	std::vector<glm::vec2> sampleOffsets;
+	std::vector<int> sampleOrder;         // adaptive:  the grid samples, best spread first
+	bool adaptive = false;
+	bool keepGBuffer = false;
+	size_t gbufferBudget = size_t(256) << 20;
+	bool keepIds = false;
+	bool reshading = false;               // the render shades from the G-buffer
+	std::vector<char> retraceLights;      // reshading:  per light, trace its shadow rays again
+	std::vector<ShadowCache> shadowCaches;  // per worker, kept over the tiles and passes of a render
+
+	FrameBuffer back;                     // written by the workers
+	std::vector<float> lumaSquares;       // adaptive:  per pixel sum of squared sample luminance
+	std::vector<char> noisy, active;      // adaptive:  pixels over the threshold, and with neighbours
+	std::vector<GSample> gbuffer;         // gbufferSlots per framebuffer pixel, by sample number
+	std::vector<int> ids;                 // per framebuffer pixel, the primitive of its first sample
+	int gbufferSlots = 0;                 // 0 without a G-buffer
+	bool gbufferValid = false;            // it holds every sample of a finished image
+	ofPixels front;                       // last published image, tonemapped
+	ToneMap frontToneMap;
+	std::mutex frontMutex;
+	bool frontChanged = false;
+
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> cancelled{ false };
+	std::atomic<bool> finished{ false };
+	std::atomic<int> pass{ 0 };
+	std::atomic<uint64_t> samplesTraced{ 0 };
+	int numPasses = 0;
+	uint64_t startTime = 0, lastPublish = 0;
+	uint64_t firstImageTime = 0, renderTime = 0;
+};
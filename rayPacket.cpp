@@ -0,0 +1,160 @@
+#include "rayPacket.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RAY_PACKET_X86
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//  scalar lanes, one float at a time
+//
+struct ScalarLanes {
+	static const int width = 1;
+	typedef float F;
+	typedef bool M;
+	static F load(const float* p) { return *p; }
+	static void store(float* p, F a) { *p = a; }
+	static F set(float a) { return a; }
+	static F add(F a, F b) { return a + b; }
+	static F sub(F a, F b) { return a - b; }
+	static F mul(F a, F b) { return a * b; }
+	static F div(F a, F b) { return a / b; }
+	static F sqrt(F a) { return std::sqrt(a); }
+	static F min(F a, F b) { return a < b ? a : b; }
+	static F max(F a, F b) { return a > b ? a : b; }
+	static F abs(F a) { return std::fabs(a); }
+	static M lt(F a, F b) { return a < b; }
+	static M gt(F a, F b) { return a > b; }
+	static M ngt(F a, F b) { return !(a > b); }
+	static M nlt(F a, F b) { return !(a < b); }
+	static M mand(M a, M b) { return a && b; }
+	static M mor(M a, M b) { return a || b; }
+	static F select(M m, F a, F b) { return m ? a : b; }
+	static int bits(M m) { return m ? 1 : 0; }
+};
+
+#ifdef RAY_PACKET_X86
+//  SSE2 lanes, 4 floats at a time.  SSE2 is part of every x86-64 CPU so these need no
+//  special compiler flags
+//
+struct SSELanes {
+	static const int width = 4;
+	typedef __m128 F;
+	typedef __m128 M;
+	static F load(const float* p) { return _mm_load_ps(p); }
+	static void store(float* p, F a) { _mm_store_ps(p, a); }
+	static F set(float a) { return _mm_set1_ps(a); }
+	static F add(F a, F b) { return _mm_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm_div_ps(a, b); }
+	static F sqrt(F a) { return _mm_sqrt_ps(a); }
+	static F min(F a, F b) { return _mm_min_ps(a, b); }
+	static F max(F a, F b) { return _mm_max_ps(a, b); }
+	static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+	static M gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+	static M ngt(F a, F b) { return _mm_cmpngt_ps(a, b); }
+	static M nlt(F a, F b) { return _mm_cmpnlt_ps(a, b); }
+	static M mand(M a, M b) { return _mm_and_ps(a, b); }
+	static M mor(M a, M b) { return _mm_or_ps(a, b); }
+	static F select(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+	static int bits(M m) { return _mm_movemask_ps(m); }
+};
+#endif
+
+#include "rayPacketKernels.h"
+
+#ifdef RAY_PACKET_X86
+void tracePacketAVX2(const PacketScene& scene, RayPacket& packet);    // rayPacketAVX2.cpp
+#endif
+
+void RayPacket::clear() {
+	for (int i = 0; i < packetSize; i++) {
+		// harmless ray for the unused lanes: no NaNs in the box tests, and a closest hit
+		// distance of -infinity, which nothing can beat
+		ox[i] = oy[i] = oz[i] = 0;
+		dx[i] = dy[i] = dz[i] = 1;
+		idx[i] = idy[i] = idz[i] = 1;
+		dist[i] = -std::numeric_limits<float>::infinity();
+		prim[i] = -1;
+	}
+	sphereTests = planeTests = otherTests = boxTests = 0;
+}
+
+void RayPacket::setRay(int i, const glm::vec3& o, const glm::vec3& d) {
+	ox[i] = o.x; oy[i] = o.y; oz[i] = o.z;
+	dx[i] = d.x; dy[i] = d.y; dz[i] = d.z;
+	idx[i] = 1.0f / d.x; idy[i] = 1.0f / d.y; idz[i] = 1.0f / d.z;
+	dist[i] = std::numeric_limits<float>::infinity();
+	prim[i] = -1;
+}
+
+static bool cpuHasAVX2() {
+#ifdef RAY_PACKET_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx) return false;
+	if ((_xgetbv(0) & 0x6) != 0x6) return false;    // OS saves the ymm registers
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+#else
+	return false;
+#endif
+}
+
+PacketISA bestPacketISA() {
+	static PacketISA best = cpuHasAVX2() ? PACKET_ISA_AVX2 :
+#ifdef RAY_PACKET_X86
+		PACKET_ISA_SSE2;
+#else
+		PACKET_ISA_SCALAR;
+#endif
+	return best;
+}
+
+static PacketISA currentISA = bestPacketISA();
+
+bool setPacketISA(PacketISA isa) {
+	if (isa > bestPacketISA()) return false;
+	currentISA = isa;
+	return true;
+}
+
+PacketISA getPacketISA() {
+	return currentISA;
+}
+
+const char* packetISAName(PacketISA isa) {
+	switch (isa) {
+	case PACKET_ISA_AVX2: return "avx2";
+	case PACKET_ISA_SSE2: return "sse2";
+	default: return "scalar";
+	}
+}
+
+void tracePacket(const PacketScene& scene, RayPacket& packet) {
+	switch (currentISA) {
+#ifdef RAY_PACKET_X86
+	case PACKET_ISA_AVX2:
+		tracePacketAVX2(scene, packet);
+		break;
+	case PACKET_ISA_SSE2:
+		tracePacketLanes<SSELanes>(scene, packet);
+		break;
+#endif
+	default:
+		tracePacketLanes<ScalarLanes>(scene, packet);
+		break;
+	}
+}
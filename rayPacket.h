@@ -0,0 +1,81 @@
+#pragma once
+
+#include "bvh.h"
+
+//  Ray packets
+//
+//  Coherent rays (neighbouring pixels, or the samples of one pixel) are traced together
+//  through the BVH as a packet of packetSize rays stored structure-of-arrays, so the
+//  box and primitive tests run on all lanes at once with SSE (2 x 4 lanes) or AVX2
+//  (8 lanes).  The kernel set is chosen at run time from what the CPU supports, with a
+//  plain scalar version as the fallback.
+//
+static const int packetSize = 8;
+
+struct RayPacket {
+	alignas(32) float ox[packetSize];
+	alignas(32) float oy[packetSize];
+	alignas(32) float oz[packetSize];
+	alignas(32) float dx[packetSize];
+	alignas(32) float dy[packetSize];
+	alignas(32) float dz[packetSize];
+	alignas(32) float idx[packetSize];     // 1 / direction, for the box tests
+	alignas(32) float idy[packetSize];
+	alignas(32) float idz[packetSize];
+
+	// closest hit so far.  dist is the distance from the ray origin to the hit point (the
+	// same measure the scalar path compares), prim is the BVH primitive or -1
+	//
+	alignas(32) float dist[packetSize];
+	int prim[packetSize];
+
+	// tests made by the last trace, each against the whole packet
+	//
+	int sphereTests, planeTests, otherTests, boxTests;
+
+	// set lane i to the ray (o, d).  Lanes that are not set up stay inactive
+	//
+	void setRay(int i, const glm::vec3& o, const glm::vec3& d);
+	void clear();
+};
+
+//  The BVH and primitives to trace against, as plain pointers into the caller's
+//  arrays, so that the kernels never call into code compiled for a different
+//  instruction set.  Primitives [0, numSpheres) are spheres, the next numPlanes are
+//  axis aligned planes, and anything after that goes through hitOther.
+//
+struct PacketScene {
+	const BVHNode* nodes = nullptr;       // empty scene if null
+	const int* primIndices = nullptr;
+
+	int numSpheres = 0;
+	const float* sphereX = nullptr;
+	const float* sphereY = nullptr;
+	const float* sphereZ = nullptr;
+	const float* sphereRadius = nullptr;
+
+	// planePlacement holds 5 floats per plane: the offset along the normal axis, then
+	// the open ranges (lo, hi) the hit must fall in along the next two axes
+	//
+	int numPlanes = 0;
+	const int* planeAxis = nullptr;
+	const float* planePlacement = nullptr;
+
+	// fallback for the other primitives: returns true and the hit distance if the ray
+	// in the given lane hits the primitive
+	//
+	bool (*hitOther)(const void* context, int prim, const RayPacket& packet, int lane, float& dist) = nullptr;
+	const void* context = nullptr;
+};
+
+// find the closest primitive hit by every active lane of the packet
+//
+void tracePacket(const PacketScene& scene, RayPacket& packet);
+
+// kernel selection.  setPacketISA returns false if the CPU cannot run the requested set
+//
+enum PacketISA { PACKET_ISA_SCALAR, PACKET_ISA_SSE2, PACKET_ISA_AVX2 };
+PacketISA bestPacketISA();
+bool setPacketISA(PacketISA isa);
+PacketISA getPacketISA();
+const char* packetISAName(PacketISA isa);
@@ -0,0 +1,63 @@
+// AVX2 build of the packet kernels.  This file is compiled for AVX2 through the target
+// pragmas below (no project-wide flags needed), and is only ever called after
+// bestPacketISA() has checked that the CPU supports it.
+//
+#include "rayPacket.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+
+// every standard header has to be included above this point, so that none of their
+// inline functions get compiled for AVX2
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace {
+
+//  AVX lanes, 8 floats at a time
+//
+struct AVXLanes {
+	static const int width = 8;
+	typedef __m256 F;
+	typedef __m256 M;
+	static F load(const float* p) { return _mm256_load_ps(p); }
+	static void store(float* p, F a) { _mm256_store_ps(p, a); }
+	static F set(float a) { return _mm256_set1_ps(a); }
+	static F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm256_div_ps(a, b); }
+	static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+	static F min(F a, F b) { return _mm256_min_ps(a, b); }
+	static F max(F a, F b) { return _mm256_max_ps(a, b); }
+	static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static M gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static M ngt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_NGT_UQ); }
+	static M nlt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_NLT_UQ); }
+	static M mand(M a, M b) { return _mm256_and_ps(a, b); }
+	static M mor(M a, M b) { return _mm256_or_ps(a, b); }
+	static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+	static int bits(M m) { return _mm256_movemask_ps(m); }
+};
+
+}
+
+#include "rayPacketKernels.h"
+
+void tracePacketAVX2(const PacketScene& scene, RayPacket& packet) {
+	tracePacketLanes<AVXLanes>(scene, packet);
+	_mm256_zeroupper();
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+// Packet traversal and primitive kernels, written once against a "lane" type and
+// compiled for each instruction set by the files that include this.  Includers must
+// pull in rayPacket.h (and any intrinsics header) first: this file is meant to be
+// included after a target pragma, so it does not include anything itself and keeps
+// everything in an anonymous namespace, which stops the differently compiled copies
+// from being merged by the linker.
+//
+//  A lane type L provides
+//      L::width                 lanes per register (must divide packetSize)
+//      L::F, L::M               float register and compare mask types
+//      load, store, set         aligned load / store, broadcast
+//      add, sub, mul, div, sqrt, min, max, abs
+//      lt, gt, ngt, nlt         compares (ngt / nlt are true for NaN, like !(a > b))
+//      mand, mor, select        mask ops, select(m, a, b) = m ? a : b
+//      bits                     mask -> int, one bit per lane
+//
+
+namespace {
+
+static const float packetEps = 1.1920929e-07f;    // glm::epsilon<float>(), as used by glm::intersect*
+static const float packetInf = std::numeric_limits<float>::infinity();
+static const float packetFarScale = 1.0000004f;   // how far AABB::intersect pushes tFar out
+
+// distance from o to the hit point o + d * t, computed the way the scalar path does it:
+// glm::distance(o, point), which subtracts o back off the rounded point
+//
+template<typename L>
+inline typename L::F hitDistance(typename L::F t, typename L::F ox, typename L::F oy, typename L::F oz, typename L::F dx, typename L::F dy, typename L::F dz) {
+	typedef typename L::F F;
+	F px = L::sub(L::add(ox, L::mul(dx, t)), ox);
+	F py = L::sub(L::add(oy, L::mul(dy, t)), oy);
+	F pz = L::sub(L::add(oz, L::mul(dz, t)), oz);
+	return L::sqrt(L::add(L::add(L::mul(px, px), L::mul(py, py)), L::mul(pz, pz)));
+}
+
+// keep the new hits that are closer than what the lanes already have
+//
+template<typename L>
+inline void recordHits(RayPacket& r, int c, typename L::M hit, typename L::F dist, int prim) {
+	typedef typename L::F F;
+	F current = L::load(r.dist + c);
+	hit = L::mand(hit, L::lt(dist, current));
+	int bits = L::bits(hit);
+	if (bits == 0) return;
+	L::store(r.dist + c, L::select(hit, dist, current));
+	for (int i = 0; i < L::width; i++) {
+		if (bits & (1 << i)) r.prim[c + i] = prim;
+	}
+}
+
+// glm::intersectRaySphere on every lane
+//
+template<typename L>
+inline void intersectSphere(RayPacket& r, const PacketScene& scene, int prim) {
+	typedef typename L::F F;
+	typedef typename L::M M;
+	F cx = L::set(scene.sphereX[prim]), cy = L::set(scene.sphereY[prim]), cz = L::set(scene.sphereZ[prim]);
+	F r2 = L::set(scene.sphereRadius[prim] * scene.sphereRadius[prim]);
+	F eps = L::set(packetEps);
+
+	for (int c = 0; c < packetSize; c += L::width) {
+		F ox = L::load(r.ox + c), oy = L::load(r.oy + c), oz = L::load(r.oz + c);
+		F dx = L::load(r.dx + c), dy = L::load(r.dy + c), dz = L::load(r.dz + c);
+		F diffx = L::sub(cx, ox), diffy = L::sub(cy, oy), diffz = L::sub(cz, oz);
+		F t0 = L::add(L::add(L::mul(diffx, dx), L::mul(diffy, dy)), L::mul(diffz, dz));
+		F dSquared = L::sub(L::add(L::add(L::mul(diffx, diffx), L::mul(diffy, diffy)), L::mul(diffz, diffz)), L::mul(t0, t0));
+		M hit = L::ngt(dSquared, r2);
+		if (L::bits(hit) == 0) continue;
+
+		F t1 = L::sqrt(L::sub(r2, dSquared));
+		F t = L::select(L::gt(t0, L::add(t1, eps)), L::sub(t0, t1), L::add(t0, t1));
+		hit = L::mand(hit, L::gt(t, eps));
+		if (L::bits(hit) == 0) continue;
+		recordHits<L>(r, c, hit, hitDistance<L>(t, ox, oy, oz, dx, dy, dz), prim);
+	}
+}
+
+// glm::intersectRayPlane against an axis aligned plane, followed by the rectangle
+// test of Plane::intersect
+//
+template<typename L>
+inline void intersectAxisPlane(RayPacket& r, const PacketScene& scene, int plane, int prim) {
+	typedef typename L::F F;
+	typedef typename L::M M;
+	const float* o[3] = { r.ox, r.oy, r.oz };
+	const float* d[3] = { r.dx, r.dy, r.dz };
+	const float* placement = scene.planePlacement + 5 * plane;
+	int k = scene.planeAxis[plane], a = (k + 1) % 3, b = (k + 2) % 3;
+	F offset = L::set(placement[0]);
+	F loA = L::set(placement[1]), hiA = L::set(placement[2]);
+	F loB = L::set(placement[3]), hiB = L::set(placement[4]);
+	F eps = L::set(packetEps);
+	F zero = L::set(0);
+
+	for (int c = 0; c < packetSize; c += L::width) {
+		F dk = L::load(d[k] + c);
+		F t = L::div(L::sub(offset, L::load(o[k] + c)), dk);
+		M hit = L::mand(L::gt(L::abs(dk), eps), L::gt(t, zero));
+		if (L::bits(hit) == 0) continue;
+
+		F da = L::load(d[a] + c), db = L::load(d[b] + c);
+		F pa = L::add(L::load(o[a] + c), L::mul(t, da));
+		F pb = L::add(L::load(o[b] + c), L::mul(t, db));
+		hit = L::mand(hit, L::mand(L::mand(L::lt(pa, hiA), L::gt(pa, loA)), L::mand(L::lt(pb, hiB), L::gt(pb, loB))));
+		if (L::bits(hit) == 0) continue;
+		recordHits<L>(r, c, hit, hitDistance<L>(t, L::load(r.ox + c), L::load(r.oy + c), L::load(r.oz + c), L::load(r.dx + c), L::load(r.dy + c), L::load(r.dz + c)), prim);
+	}
+}
+
+// slab test of one box against every lane, the same as AABB::intersect.  Returns one
+// bit per lane that enters the box before its current closest hit, and the nearest
+// entry distance over those lanes
+//
+template<typename L>
+inline int intersectBox(const RayPacket& r, const AABB& box, float& nearest) {
+	typedef typename L::F F;
+	typedef typename L::M M;
+	F minx = L::set(box.min.x), miny = L::set(box.min.y), minz = L::set(box.min.z);
+	F maxx = L::set(box.max.x), maxy = L::set(box.max.y), maxz = L::set(box.max.z);
+	F zero = L::set(0);
+	F farScale = L::set(packetFarScale);
+	int hitBits = 0;
+	nearest = packetInf;
+
+	for (int c = 0; c < packetSize; c += L::width) {
+		F ox = L::load(r.ox + c), oy = L::load(r.oy + c), oz = L::load(r.oz + c);
+		F idx = L::load(r.idx + c), idy = L::load(r.idy + c), idz = L::load(r.idz + c);
+		F tx0 = L::mul(L::sub(minx, ox), idx), tx1 = L::mul(L::sub(maxx, ox), idx);
+		F ty0 = L::mul(L::sub(miny, oy), idy), ty1 = L::mul(L::sub(maxy, oy), idy);
+		F tz0 = L::mul(L::sub(minz, oz), idz), tz1 = L::mul(L::sub(maxz, oz), idz);
+		F tNear = L::max(L::max(L::min(tx0, tx1), L::min(ty0, ty1)), L::min(tz0, tz1));
+		F tFar = L::mul(L::min(L::min(L::max(tx0, tx1), L::max(ty0, ty1)), L::max(tz0, tz1)), farScale);
+		M hit = L::mand(L::mand(L::nlt(tFar, zero), L::ngt(tNear, tFar)), L::ngt(tNear, L::load(r.dist + c)));
+		int bits = L::bits(hit);
+		if (bits == 0) continue;
+
+		alignas(32) float entry[L::width];
+		L::store(entry, tNear);
+		for (int i = 0; i < L::width; i++) {
+			if ((bits & (1 << i)) && entry[i] < nearest) nearest = entry[i];
+		}
+		hitBits |= bits << c;
+	}
+	return hitBits;
+}
+
+template<typename L>
+void tracePacketLanes(const PacketScene& scene, RayPacket& r) {
+	const BVHNode* nodes = scene.nodes;
+	const int* primIndices = scene.primIndices;
+	if (nodes == nullptr) return;
+
+	float entry;
+	r.boxTests++;
+	if (intersectBox<L>(r, nodes[0].bounds, entry) == 0) return;
+
+	int stack[BVH::maxDepth + 4];
+	int sp = 0;
+	int node = 0;
+	for (;;) {
+		const BVHNode& n = nodes[node];
+		if (n.count > 0) {
+			for (int i = 0; i < n.count; i++) {
+				int prim = primIndices[n.leftFirst + i];
+				if (prim < scene.numSpheres) {
+					r.sphereTests++;
+					intersectSphere<L>(r, scene, prim);
+				}
+				else if (prim < scene.numSpheres + scene.numPlanes) {
+					r.planeTests++;
+					intersectAxisPlane<L>(r, scene, prim - scene.numSpheres, prim);
+				}
+				else {
+					r.otherTests++;
+					for (int lane = 0; lane < packetSize; lane++) {
+						float dist;
+						if (r.dist[lane] > -packetInf && scene.hitOther(scene.context, prim, r, lane, dist) && dist < r.dist[lane]) {
+							r.dist[lane] = dist;
+							r.prim[lane] = prim;
+						}
+					}
+				}
+			}
+			if (sp == 0) return;
+			node = stack[--sp];
+			continue;
+		}
+
+		// visit the child the packet reaches first, come back for the other one later
+		//
+		int nearChild = n.leftFirst, farChild = n.leftFirst + 1;
+		float tNear, tFar;
+		r.boxTests += 2;
+		int nearBits = intersectBox<L>(r, nodes[nearChild].bounds, tNear);
+		int farBits = intersectBox<L>(r, nodes[farChild].bounds, tFar);
+		if (nearBits == 0 || (farBits != 0 && tFar < tNear)) {
+			int t = nearChild; nearChild = farChild; farChild = t;
+			int b = nearBits; nearBits = farBits; farBits = b;
+		}
+		if (nearBits == 0) {
+			if (sp == 0) return;
+			node = stack[--sp];
+			continue;
+		}
+		node = nearChild;
+		if (farBits != 0) stack[sp++] = farChild;
+	}
+}
+
+}
@@ -0,0 +1,674 @@
+#include "renderScene.h"
+#include <map>
+#include <tuple>
+
+// packet fallback for primitives the SIMD kernels do not know about
+//
+static bool hitOtherPrim(const void* context, int prim, const RayPacket& packet, int lane, float& dist) {
+	const RenderScene* rs = (const RenderScene*)context;
+	Ray ray(glm::vec3(packet.ox[lane], packet.oy[lane], packet.oz[lane]), glm::vec3(packet.dx[lane], packet.dy[lane], packet.dz[lane]));
+	glm::vec3 point, normal;
+	if (!rs->intersectPrim(prim, ray, point, normal)) return false;
+	dist = glm::distance(ray.p, point);
+	return true;
+}
+
+void RenderScene::compile(const vector<SceneObject*>& scene, const vector<Light*>& lights, const RenderCam& cam) {
+	camera = cam;
+
+	sphereX.clear(); sphereY.clear(); sphereZ.clear(); sphereRadius.clear();
+	planeAxis.clear(); planePlacement.clear(); planePosition.clear(); planeNormal.clear();
+	planeWidth.clear(); planeHeight.clear();
+	others.clear();
+	primMaterial.clear(); primCastsShadow.clear(); primObject.clear(); materials.clear(); textures.clear(); textureFiles.clear();
+
+	// sort the objects by type.  Planes whose normal is not along an axis never report
+	// a hit (see Plane::intersect), so they are left out altogether
+	//
+	vector<SceneObject*> spheres, planes, bounded, unbounded;
+	for (auto obj : scene) {
+		AABB box;
+		Sphere* sphere = dynamic_cast<Sphere*> (obj);
+		Plane* plane = dynamic_cast<Plane*> (obj);
+		if (sphere != nullptr)
+			spheres.push_back(obj);
+		else if (plane != nullptr) {
+			if (plane->getBounds(box)) planes.push_back(obj);
+		}
+		else if (obj->getBounds(box))
+			bounded.push_back(obj);
+		else
+			unbounded.push_back(obj);
+	}
+
+	for (auto obj : spheres) {
+		Sphere* sphere = (Sphere*)obj;
+		sphereX.push_back(sphere->position.x);
+		sphereY.push_back(sphere->position.y);
+		sphereZ.push_back(sphere->position.z);
+		sphereRadius.push_back(sphere->radius);
+		primObject.push_back(obj);
+	}
+
+	for (auto obj : planes) {
+		Plane* plane = (Plane*)obj;
+
+		// same ranges as Plane::intersect, listed for the two axes that follow the normal
+		// axis (x -> y, z   y -> z, x   z -> x, y)
+		glm::vec2 xrange = glm::vec2(plane->position.x - plane->width / 2, plane->position.x + plane->width / 2);
+		glm::vec2 yrange = glm::vec2(plane->position.y - plane->width / 2, plane->position.y + plane->width / 2);
+		glm::vec2 zrange = glm::vec2(plane->position.z - plane->height / 2, plane->position.z + plane->height / 2);
+		glm::vec2 ranges[3] = { xrange, yrange, zrange };
+		int axis = plane->normal.x != 0 ? 0 : (plane->normal.y != 0 ? 1 : 2);
+		planeAxis.push_back(axis);
+		planePlacement.push_back(plane->position[axis]);
+		planePlacement.push_back(ranges[(axis + 1) % 3][0]);
+		planePlacement.push_back(ranges[(axis + 1) % 3][1]);
+		planePlacement.push_back(ranges[(axis + 2) % 3][0]);
+		planePlacement.push_back(ranges[(axis + 2) % 3][1]);
+		planePosition.push_back(plane->position);
+		planeNormal.push_back(plane->normal);
+		planeWidth.push_back(plane->width);
+		planeHeight.push_back(plane->height);
+		primObject.push_back(obj);
+	}
+
+	numBounded = spheres.size() + planes.size() + bounded.size();
+	for (auto obj : bounded) primObject.push_back(obj);
+	for (auto obj : unbounded) primObject.push_back(obj);
+	for (int i = spheres.size() + planes.size(); i < primObject.size(); i++) {
+		others.push_back(primObject[i]);
+	}
+	for (int i = 0; i < primObject.size(); i++) {
+		primCastsShadow.push_back(dynamic_cast<Plane*> (primObject[i]) == nullptr);
+	}
+
+	// a material per object, stored once however many objects share it (instances of
+	// one model mostly do)
+	//
+	map<tuple<int, int, int, int, int, int, const MipTexture*, const MipTexture*>, int> materialIndex;
+	for (auto obj : primObject) {
+		Material m;
+		m.diffuse = obj->diffuseColor;
+		m.specular = obj->specularColor;
+		if (obj->textured && obj->mipTexture && obj->mipSpecularTexture) {
+			m.texture = obj->mipTexture.get();
+			m.specularTexture = obj->mipSpecularTexture.get();
+		}
+		auto key = make_tuple(m.diffuse.r, m.diffuse.g, m.diffuse.b, m.specular.r, m.specular.g, m.specular.b, m.texture, m.specularTexture);
+		auto found = materialIndex.find(key);
+		if (found != materialIndex.end()) {
+			primMaterial.push_back(found->second);
+			continue;
+		}
+		if (m.texture != nullptr && !obj->textureFile.empty()) {
+			m.textureFile = textureFiles.size();
+			m.specularTextureFile = textureFiles.size() + 1;
+			textureFiles.push_back(obj->textureFile);
+			textureFiles.push_back(obj->specularTextureFile);
+		}
+		materialIndex[key] = materials.size();
+		primMaterial.push_back(materials.size());
+		materials.push_back(m);
+	}
+
+	lightPosition.clear();
+	lightIntensity.clear();
+	for (auto light : lights) {
+		lightPosition.push_back(light->position);
+		lightIntensity.push_back(light->intensity);
+	}
+
+	// BVH over the bounded primitives
+	//
+	vector<AABB> bounds(numBounded);
+	for (int i = 0; i < numBounded; i++) {
+		primObject[i]->getBounds(bounds[i]);
+	}
+	bvh.build(bounds);
+	setupPacketScene();
+	setupLights();
+}
+
+void RenderScene::setupPacketScene() {
+	packetScene.nodes = bvh.isEmpty() ? nullptr : bvh.nodes.data();
+	packetScene.primIndices = bvh.primIndices.data();
+	packetScene.numSpheres = numSpheres();
+	packetScene.sphereX = sphereX.data();
+	packetScene.sphereY = sphereY.data();
+	packetScene.sphereZ = sphereZ.data();
+	packetScene.sphereRadius = sphereRadius.data();
+	packetScene.numPlanes = numPlanes();
+	packetScene.planeAxis = planeAxis.data();
+	packetScene.planePlacement = planePlacement.data();
+	packetScene.hitOther = &hitOtherPrim;
+	packetScene.context = this;
+}
+
+// with falloff, a light of intensity I lights a surface at distance d with I / d^2,
+// which drops below the cutoff at sqrt(I / cutoff).  phong fades it out to exactly zero
+// there, so the lights can be binned by that radius without changing the image
+//
+void RenderScene::setupLights() {
+	lightRadius.assign(lightPosition.size(), std::numeric_limits<float>::infinity());
+	lightGrid.clear();
+	if (lightFalloff && lightCutoff > 0) {
+		for (int i = 0; i < lightPosition.size(); i++) {
+			lightRadius[i] = sqrtf(std::max(lightIntensity[i], 0.0f) / lightCutoff);
+		}
+		if (!bvh.isEmpty()) lightGrid.build(lightPosition, lightRadius, bvh.nodes[0].bounds);
+	}
+	selectShader();
+}
+
+// Intersect a ray with one primitive.  Spheres and planes repeat the arithmetic of
+// Sphere::intersect and Plane::intersect exactly
+//
+bool RenderScene::intersectPrim(int prim, const Ray& ray, glm::vec3& point, glm::vec3& normal) const {
+	if (isSphere(prim)) {
+		return glm::intersectRaySphere(ray.p, ray.d, glm::vec3(sphereX[prim], sphereY[prim], sphereZ[prim]), sphereRadius[prim], point, normal);
+	}
+	if (isPlane(prim)) {
+		int i = prim - numSpheres();
+		float dist;
+		if (!glm::intersectRayPlane(ray.p, ray.d, planePosition[i], planeNormal[i], dist)) return false;
+		point = ray.p + dist * ray.d;
+		normal = planeNormal[i];
+		const float* placement = &planePlacement[5 * i];
+		int a = (planeAxis[i] + 1) % 3, b = (planeAxis[i] + 2) % 3;
+		return point[a] < placement[2] && point[a] > placement[1] && point[b] < placement[4] && point[b] > placement[3];
+	}
+	return others[prim - numSpheres() - numPlanes()]->intersect(ray, point, normal);
+}
+
+// count one ray / primitive test
+//
+static void countTest(RenderCounters* counters, const RenderScene& scene, int prim) {
+	if (counters == nullptr) return;
+	if (scene.isSphere(prim)) counters->sphereTests++;
+	else if (scene.isPlane(prim)) counters->planeTests++;
+	else counters->otherTests++;
+}
+
+static uint64_t nanoTime() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// find the closest primitive hit by the ray, or -1 if there is none
+//
+int RenderScene::closestHit(const Ray& ray, glm::vec3& point, glm::vec3& normal, RenderCounters* counters) const {
+	float shortestDistance = std::numeric_limits<float>::infinity();
+	int closest = -1;
+	glm::vec3 intersectPoint, intersectNormal;
+
+	auto testPrim = [&](int prim, float& tMax) {
+		countTest(counters, *this, prim);
+		if (intersectPrim(prim, ray, intersectPoint, intersectNormal)) {
+			float currentDistance = glm::distance(ray.p, intersectPoint);
+			if (currentDistance < tMax) { // only use the color of the closest intersection
+				tMax = currentDistance;
+				point = intersectPoint;
+				normal = intersectNormal;
+				closest = prim;
+			}
+		}
+	};
+
+	for (int prim = numBounded; prim < numPrims(); prim++) {
+		testPrim(prim, shortestDistance);
+	}
+	bvh.closestHit(ray.p, ray.d, shortestDistance, testPrim, counters != nullptr ? &counters->boxTests : nullptr);
+	return closest;
+}
+
+// is the point the ray starts from in shadow along the ray?  Planes do not cast shadows
+//
+bool RenderScene::inShadow(const Ray& theRay) const {
+	return occluded(theRay.p, theRay.d, -1, nullptr);
+}
+
+// Any object in the way is enough, so this stops at the first one.  The light's last
+// occluder goes first, then the unbounded objects, then the BVH
+//
+bool RenderScene::occluded(const glm::vec3& p, const glm::vec3& l, int light, ShadowCache* cache) const {
+	float eps = .01; // offset
+	glm::vec3 o = p + l * eps;
+	RenderCounters* counters = cache != nullptr ? cache->counters : nullptr;
+	if (counters != nullptr) counters->shadowRays++;
+
+	auto blocks = [&](int prim) {
+		if (!primCastsShadow[prim]) return false;
+		countTest(counters, *this, prim);
+		glm::vec3 point, normal;
+		if (isSphere(prim)) {
+			return glm::intersectRaySphere(o, l, glm::vec3(sphereX[prim], sphereY[prim], sphereZ[prim]), sphereRadius[prim], point, normal);
+		}
+		if (isPlane(prim)) return intersectPrim(prim, Ray(o, l), point, normal);
+		return others[prim - numSpheres() - numPlanes()]->intersectAny(Ray(o, l));
+	};
+
+	int* last = (cache != nullptr && light >= 0) ? &cache->lastOccluder[light] : nullptr;
+	if (last != nullptr && *last >= 0 && *last < numPrims() && blocks(*last)) return true;
+
+	int occluder = -1;
+	for (int prim = numBounded; prim < numPrims() && occluder < 0; prim++) {
+		if (blocks(prim)) occluder = prim;
+	}
+	if (occluder < 0) {
+		bvh.anyHit(o, l, std::numeric_limits<float>::infinity(), [&](int prim) {
+			if (!blocks(prim)) return false;
+			occluder = prim;
+			return true;
+		}, counters != nullptr ? &counters->boxTests : nullptr);
+	}
+	if (last != nullptr) *last = occluder;
+	return occluder >= 0;
+}
+
+// trace the camera ray through (u, v) on the view plane and shade the closest surface
+// it hits
+//
+glm::vec3 RenderScene::traceSample(float u, float v, float du, float dv, ShadowCache* cache) const {
+	RayDifferential diff;
+	Ray theRay = camera.getRay(u, v, du, dv, diff);
+	glm::vec3 closeIntersect, closeNormal;
+	int closest = closestHit(theRay, closeIntersect, closeNormal, cache != nullptr ? cache->counters : nullptr);
+
+	// if the ray does not hit an object
+	if (closest < 0) {
+		return linearColor(background);
+	}
+	return shade(closest, closeIntersect, closeNormal, cache, &theRay, &diff);
+}
+
+// fill in what a sample hit, and point the cache at its light bits for shading
+//
+static void keepSample(GSample& g, int prim, const glm::vec3& point, const glm::vec3& normal, ShadowCache& cache) {
+	g.prim = prim;
+	g.point = point;
+	g.normal = normal;
+	g.lit = 0;
+	cache.visibility = &g.lit;
+}
+
+// the caller's cache, kept from one call to the next, or local if there is none.  The
+// last occluders are only kept while the lights stay the same
+//
+static ShadowCache& shadowCache(ShadowCache* cache, ShadowCache& local, int numLights, RenderCounters* counters) {
+	ShadowCache& c = cache != nullptr ? *cache : local;
+	if (c.lastOccluder.size() != numLights) c.reset(numLights);
+	c.counters = counters;
+	c.visibility = nullptr;
+	c.replay = false;
+	c.retrace = nullptr;
+	return c;
+}
+
+// trace n camera rays, (u[i], v[i]) on the view plane, in packets.  Gives exactly the
+// same colors as calling traceSample on each of them
+//
+void RenderScene::traceSamples(const float* u, const float* v, int n, float du, float dv, glm::vec3* colors,
+	RenderCounters* counters, float* cost, GSample* gsamples, int* prims, ShadowCache* shadows) const {
+	TraceFunction trace = gsamples != nullptr ? shader.traceGBuffer : shader.trace;
+	if (trace != nullptr) (this->*trace)(u, v, n, du, dv, colors, counters, cost, gsamples, prims, shadows);
+	else if (lightFalloff) traceKernel<true, true, true, 0, true>(u, v, n, du, dv, colors, counters, cost, gsamples, prims, shadows);
+	else traceKernel<true, true, false, 0, true>(u, v, n, du, dv, colors, counters, cost, gsamples, prims, shadows);
+}
+
+// Timing is per sample, except that the packet trace is shared out evenly over the
+// rays of the packet.  Without GBuffer, gsamples is not looked at
+//
+template<bool Textured, bool Shadows, bool Falloff, int NumLights, bool GBuffer>
+void RenderScene::traceKernel(const float* u, const float* v, int n, float du, float dv, glm::vec3* colors,
+	RenderCounters* counters, float* cost, GSample* gsamples, int* prims, ShadowCache* shadows) const {
+	ShadowCache local;
+	ShadowCache& cache = shadowCache(shadows, local, lightPosition.size(), counters);
+	bool timed = counters != nullptr || cost != nullptr;
+	if (counters != nullptr) counters->primaryRays += n;
+
+	auto account = [&](int i, uint64_t traceTime, uint64_t shadeTime) {
+		if (counters != nullptr) {
+			counters->traceNanos += traceTime;
+			counters->shadeNanos += shadeTime;
+		}
+		if (cost != nullptr) cost[i] = traceTime + shadeTime;
+	};
+
+	if (!usePackets) {
+		// traceSample, split in two for the timing
+		//
+		for (int i = 0; i < n; i++) {
+			uint64_t start = timed ? nanoTime() : 0;
+			RayDifferential diff;
+			Ray theRay = camera.getRay(u[i], v[i], du, dv, diff);
+			glm::vec3 closeIntersect, closeNormal;
+			int closest = closestHit(theRay, closeIntersect, closeNormal, counters);
+			uint64_t hit = timed ? nanoTime() : 0;
+			if (GBuffer && gsamples != nullptr) keepSample(gsamples[i], closest, closeIntersect, closeNormal, cache);
+			if (prims != nullptr) prims[i] = closest;
+			colors[i] = closest >= 0 ? shadeKernel<Textured, Shadows, Falloff, NumLights, GBuffer>(closest, closeIntersect, closeNormal, &cache, &theRay, &diff) : linearColor(background);
+			if (timed) account(i, hit - start, nanoTime() - hit);
+		}
+		return;
+	}
+
+	for (int first = 0; first < n; first += packetSize) {
+		int count = std::min(packetSize, n - first);
+		uint64_t start = timed ? nanoTime() : 0;
+		Ray rays[packetSize];
+		RayDifferential diffs[packetSize];
+		RayPacket packet;
+		packet.clear();
+		for (int i = 0; i < count; i++) {
+			rays[i] = camera.getRay(u[first + i], v[first + i], du, dv, diffs[i]);
+			packet.setRay(i, rays[i].p, rays[i].d);
+		}
+		tracePacket(packetScene, packet);
+		uint64_t clock = timed ? nanoTime() : 0;
+		uint64_t packetShare = (clock - start) / count;
+		if (counters != nullptr) {
+			counters->sphereTests += uint64_t(packet.sphereTests) * count;
+			counters->planeTests += uint64_t(packet.planeTests) * count;
+			counters->otherTests += uint64_t(packet.otherTests) * count;
+			counters->boxTests += uint64_t(packet.boxTests) * count;
+		}
+
+		for (int i = 0; i < count; i++) {
+			// the kernels only find which primitive is hit, the exact hit point and normal
+			// for shading come from the scalar test
+			//
+			glm::vec3 closeIntersect, closeNormal;
+			int closest = packet.prim[i];
+			if (closest >= 0) {
+				intersectPrim(closest, rays[i], closeIntersect, closeNormal);
+			}
+			float shortestDistance = packet.dist[i];
+			for (int prim = numBounded; prim < numPrims(); prim++) {
+				glm::vec3 intersectPoint, intersectNormal;
+				countTest(counters, *this, prim);
+				if (intersectPrim(prim, rays[i], intersectPoint, intersectNormal) && glm::distance(rays[i].p, intersectPoint) < shortestDistance) {
+					shortestDistance = glm::distance(rays[i].p, intersectPoint);
+					closeIntersect = intersectPoint;
+					closeNormal = intersectNormal;
+					closest = prim;
+				}
+			}
+			uint64_t hit = timed ? nanoTime() : 0;
+			if (GBuffer && gsamples != nullptr) keepSample(gsamples[first + i], closest, closeIntersect, closeNormal, cache);
+			if (prims != nullptr) prims[first + i] = closest;
+			colors[first + i] = closest >= 0 ? shadeKernel<Textured, Shadows, Falloff, NumLights, GBuffer>(closest, closeIntersect, closeNormal, &cache, &rays[i], &diffs[i]) : linearColor(background);
+			if (timed) {
+				uint64_t done = nanoTime();
+				account(first + i, packetShare + hit - clock, done - hit);
+				clock = done;
+			}
+		}
+	}
+}
+
+void RenderScene::reshadeSamples(const float* u, const float* v, int n, float du, float dv, GSample* gsamples, const char* retrace,
+	glm::vec3* colors, RenderCounters* counters, ShadowCache* shadows) const {
+	if (shader.reshade != nullptr) (this->*shader.reshade)(u, v, n, du, dv, gsamples, retrace, colors, counters, shadows);
+	else if (lightFalloff) reshadeKernel<true, true, true, 0>(u, v, n, du, dv, gsamples, retrace, colors, counters, shadows);
+	else reshadeKernel<true, true, false, 0>(u, v, n, du, dv, gsamples, retrace, colors, counters, shadows);
+}
+
+// the camera ray is only needed again for its differentials, which filter the textures
+//
+template<bool Textured, bool Shadows, bool Falloff, int NumLights>
+void RenderScene::reshadeKernel(const float* u, const float* v, int n, float du, float dv, GSample* gsamples, const char* retrace,
+	glm::vec3* colors, RenderCounters* counters, ShadowCache* shadows) const {
+	ShadowCache local;
+	ShadowCache& cache = shadowCache(shadows, local, lightPosition.size(), counters);
+	cache.replay = true;
+	cache.retrace = retrace;
+	uint64_t start = counters != nullptr ? nanoTime() : 0;
+
+	for (int i = 0; i < n; i++) {
+		GSample& g = gsamples[i];
+		if (g.prim == GSample::noSample) continue;
+		if (g.prim < 0) {
+			colors[i] = linearColor(background);
+			continue;
+		}
+		RayDifferential diff;
+		Ray theRay = camera.getRay(u[i], v[i], du, dv, diff);
+		cache.visibility = &g.lit;
+		colors[i] = shadeKernel<Textured, Shadows, Falloff, NumLights, true>(g.prim, g.point, g.normal, &cache, &theRay, &diff);
+	}
+	if (counters != nullptr) counters->shadeNanos += nanoTime() - start;
+}
+
+// texture coordinates of a point on a plane, repeating numTiles times across it, as in
+// Plane::getIJCoords
+//
+glm::vec2 RenderScene::planeUV(int p, const glm::vec3& point) const {
+	glm::vec3 position = planePosition[p];
+	float planeW = planeWidth[p];
+	float planeH = planeHeight[p];
+	float u;
+	float v = 0;
+
+	// map u
+	u = ofMap(point.x, position.x - (planeW / 2), position.x + (planeW / 2), 0.0, 1.0);
+
+	// map v depending on the normal
+	// ground
+	if (planeNormal[p] == glm::vec3(0, 1, 0)) {
+		v = ofMap(point.z, position.z - (planeH / 2), position.z + (planeH / 2), 0.0, 1.0);
+	}
+
+	// wall
+	if (planeNormal[p] == glm::vec3(0, 0, 1)) {
+		v = ofMap(point.y, position.y - (planeH / 2), position.y + (planeH / 2), 0.0, 1.0);
+	}
+	u = u * numTiles;
+	v = v * numTiles;
+	return glm::vec2(u, v);
+}
+
+// how the plane's texture coordinates change when the point moves by pointChange
+//
+glm::vec2 RenderScene::planeUVChange(int p, const glm::vec3& pointChange) const {
+	float du = pointChange.x / planeWidth[p] * numTiles;
+	float dv = 0;
+	if (planeNormal[p] == glm::vec3(0, 1, 0)) dv = pointChange.z / planeHeight[p] * numTiles;
+	if (planeNormal[p] == glm::vec3(0, 0, 1)) dv = pointChange.y / planeHeight[p] * numTiles;
+	return glm::vec2(du, dv);
+}
+
+// texel of a texture that a surface point maps to.  Planes repeat the mapping of
+// Plane::getIJCoords, other objects that are not spheres ask the object
+//
+glm::vec2 RenderScene::texelCoords(int prim, const glm::vec3& point, const MipTexture& texture, bool specular) const {
+	if (isSphere(prim)) return glm::vec2(0, 0);
+	if (!isPlane(prim)) {
+		SceneObject* obj = others[prim - numSpheres() - numPlanes()];
+		return specular ? obj->getIJCoordsSpec(point, numTiles) : obj->getIJCoords(point, numTiles);
+	}
+	glm::vec2 uv = planeUV(prim - numSpheres(), point);
+
+	// get the IJ coord from u and v
+	float textureWidth = texture.getWidth();
+	float textureHeight = texture.getHeight();
+	int i = fmod(uv.x * textureWidth - 0.5, textureWidth);
+	int j = fmod(uv.y * textureHeight - 0.5, textureHeight);
+	return glm::vec2(i, j);
+}
+
+// trilinear lookup at uv, filtered over the area that a sample covers (duvdx, duvdy are
+// its edges in texture coordinates)
+//
+glm::vec3 RenderScene::filteredTexel(const MipTexture& texture, glm::vec2 uv, glm::vec2 duvdx, glm::vec2 duvdy) const {
+	glm::vec2 size(texture.getWidth(), texture.getHeight());
+	float footprint = std::max(glm::length(duvdx * size), glm::length(duvdy * size));
+	glm::vec4 c = texture.sample(uv.x * size.x - 0.5f, uv.y * size.y - 0.5f, footprint);
+	return glm::vec3(c.x, c.y, c.z);
+}
+
+// color of a surface point, for a scene with the features the template arguments say:
+// Textured if any material may be, Shadows if anything casts them, Falloff for culled
+// lights, and NumLights if there are exactly that many (0 for any number).  GBuffer if
+// the sample's lights are kept in, or replayed from, the cache's visibility bits
+//
+template<bool Textured, bool Shadows, bool Falloff, int NumLights, bool GBuffer>
+glm::vec3 RenderScene::shadeKernel(int prim, const glm::vec3& closeIntersect, const glm::vec3& closeNormal, ShadowCache* cache,
+	const Ray* ray, const RayDifferential* diff) const {
+	const Material& m = materials[primMaterial[prim]];
+	if (Textured && m.texture != nullptr) { // if the object is textured
+		glm::vec3 textureColor, specColor;
+		if (cache != nullptr && cache->counters != nullptr) cache->counters->textureFetches += 2;
+		if (filterTextures && isPlane(prim)) {
+			int p = prim - numSpheres();
+			glm::vec2 uv = planeUV(p, closeIntersect);
+
+			// carry the ray differentials over to the surface:  moving by one sample moves
+			// the hit point along the plane by dPdx, dPdy
+			//
+			glm::vec2 duvdx(0), duvdy(0);
+			float dn = ray != nullptr ? glm::dot(ray->d, closeNormal) : 0;
+			if (diff != nullptr && dn != 0) {
+				float t = glm::distance(ray->p, closeIntersect);
+				glm::vec3 dPdx = t * diff->dDdx - ray->d * (glm::dot(t * diff->dDdx, closeNormal) / dn);
+				glm::vec3 dPdy = t * diff->dDdy - ray->d * (glm::dot(t * diff->dDdy, closeNormal) / dn);
+				duvdx = planeUVChange(p, dPdx);
+				duvdy = planeUVChange(p, dPdy);
+			}
+			textureColor = filteredTexel(*m.texture, uv, duvdx, duvdy);
+			specColor = filteredTexel(*m.specularTexture, uv, duvdx, duvdy);
+		}
+		else {
+			glm::vec2 textureCoords = texelCoords(prim, closeIntersect, *m.texture, false);
+			glm::vec2 specCoords = texelCoords(prim, closeIntersect, *m.specularTexture, true);
+			textureColor = linearColor(m.texture->texel(textureCoords.x, textureCoords.y));
+			specColor = linearColor(m.specularTexture->texel(specCoords.x, specCoords.y));
+		}
+		return phongKernel<Shadows, Falloff, NumLights, phongPower, GBuffer>(closeIntersect, closeNormal, textureColor, specColor, 0, cache);
+	}
+
+	// if the obj is not textured
+	return phongKernel<Shadows, Falloff, NumLights, phongPower, GBuffer>(closeIntersect, closeNormal, linearColor(m.diffuse), linearColor(m.specular), 0, cache);
+}
+
+// Power is the Phong exponent, or 0 to take it from power
+//
+template<bool Shadows, bool Falloff, int NumLights, int Power, bool GBuffer>
+glm::vec3 RenderScene::phongKernel(const glm::vec3& p, const glm::vec3& norm, const glm::vec3& diffuse, const glm::vec3& specular, float power, ShadowCache* cache) const {
+	const float exponent = Power > 0 ? float(Power) : power;
+	glm::vec3 ambient = 0.3f * diffuse * 1.0f;
+	glm::vec3 color = ambient;
+	// for each pixel, loop through all the lights, add up values from phong function for light value of pixel
+	// if pixel is in a shadow, color is black
+	//
+	// with falloff, only the lights of the point's grid cell (or all of them outside
+	// the grid) can reach it, and those that are too far away after all are skipped
+	// before their shadow ray
+	//
+	int numLights = NumLights > 0 ? NumLights : lightPosition.size(), cellLights = 0;
+	const int* lights = Falloff ? lightGrid.lightsAt(p, cellLights) : nullptr;
+	if (lights != nullptr) numLights = cellLights;
+	glm::vec3 n = glm::normalize(norm);
+	glm::vec3 v = glm::normalize(camera.position - p);
+
+	for (int k = 0; k < numLights; k++) {
+		int i = lights != nullptr ? lights[k] : k;
+		glm::vec3 r = lightPosition[i] - p;
+		float attenuation = 0;
+		if (Falloff) {
+			float d2 = glm::dot(r, r), r2 = lightRadius[i] * lightRadius[i];
+			if (!(d2 < r2)) continue;
+			float fade = 1 - (d2 / r2) * (d2 / r2);
+			attenuation = fade * fade / d2;
+		}
+
+		glm::vec3 l = glm::normalize(lightPosition[i] - p);
+		glm::vec3 h = glm::normalize((v + l) / glm::length(v + l));
+		glm::vec3 theLambert, thePhong;
+
+		bool lit = true;
+		uint32_t* visibility = GBuffer && cache != nullptr && i < GSample::maxLights ? cache->visibility : nullptr;
+		if (GBuffer && visibility != nullptr && cache->replay && !(cache->retrace != nullptr && cache->retrace[i]))
+			lit = (*visibility >> i) & 1;
+		else {
+			if (Shadows) lit = !occluded(p, l, i, cache);
+			if (GBuffer && visibility != nullptr) *visibility = lit ? *visibility | (1u << i) : *visibility & ~(1u << i);
+		}
+
+		if (lit) {
+			// function from slides and textbook.  The color times the intensity saturates
+			// (it used to be ofColor arithmetic, and the scenes are lit for that), the rest
+			// adds up unclamped.  r.length() is glm's component count, so without falloff
+			// every light is divided by a constant 9
+			//
+			glm::vec3 lightDiffuse, lightSpecular;
+			if (Falloff) {
+				lightDiffuse = diffuse * (lightIntensity[i] * attenuation);
+				lightSpecular = specular * (lightIntensity[i] * attenuation);
+			}
+			else {
+				float falloff = glm::pow(r.length(), 2);
+				lightDiffuse = glm::min(diffuse * lightIntensity[i], glm::vec3(1)) / falloff;
+				lightSpecular = glm::min(specular * lightIntensity[i], glm::vec3(1)) / falloff;
+			}
+			theLambert = lightDiffuse * glm::max(0.0f, glm::dot(n, l));
+			thePhong = lightSpecular * glm::max(0.0f, glm::pow(glm::dot(n, h), exponent));
+			color += (theLambert + thePhong);
+		}
+	}
+	return color;
+}
+
+// the kernels for every combination selectShader picks from.  Light counts up to
+// maxUnrolledLights get their own copy when nothing culls them
+//
+static const int maxUnrolledLights = 4;
+
+template<bool Textured, bool Shadows, bool Falloff, int NumLights>
+static RenderScene::Kernels kernels() {
+	RenderScene::Kernels k;
+	k.shade = &RenderScene::shadeKernel<Textured, Shadows, Falloff, NumLights, true>;
+	k.trace = &RenderScene::traceKernel<Textured, Shadows, Falloff, NumLights, false>;
+	k.traceGBuffer = &RenderScene::traceKernel<Textured, Shadows, Falloff, NumLights, true>;
+	k.reshade = &RenderScene::reshadeKernel<Textured, Shadows, Falloff, NumLights>;
+	return k;
+}
+
+template<bool Textured, bool Shadows>
+static RenderScene::Kernels shaderFor(bool falloff, int numLights) {
+	if (falloff) return kernels<Textured, Shadows, true, 0>();
+	switch (numLights) {
+	case 1: return kernels<Textured, Shadows, false, 1>();
+	case 2: return kernels<Textured, Shadows, false, 2>();
+	case 3: return kernels<Textured, Shadows, false, 3>();
+	case 4: return kernels<Textured, Shadows, false, 4>();
+	default: return kernels<Textured, Shadows, false, 0>();
+	}
+}
+
+void RenderScene::selectShader() {
+	bool textured = false, shadows = false;
+	for (const Material& m : materials) textured = textured || m.texture != nullptr;
+	for (char casts : primCastsShadow) shadows = shadows || casts;
+	int numLights = lightPosition.size() <= maxUnrolledLights ? lightPosition.size() : 0;
+
+	if (textured)
+		shader = shadows ? shaderFor<true, true>(lightFalloff, numLights) : shaderFor<true, false>(lightFalloff, numLights);
+	else
+		shader = shadows ? shaderFor<false, true>(lightFalloff, numLights) : shaderFor<false, false>(lightFalloff, numLights);
+	shaderName = string(textured ? "textured" : "untextured") + (shadows ? ", shadows" : ", no shadows") +
+		(lightFalloff ? ", culled lights" : numLights > 0 ? ", " + ofToString(numLights) + " lights" : ", any lights");
+}
+
+// the kernel for the scene if one was selected, the most general one otherwise
+//
+glm::vec3 RenderScene::shade(int prim, const glm::vec3& point, const glm::vec3& normal, ShadowCache* cache,
+	const Ray* ray, const RayDifferential* diff) const {
+	if (shader.shade != nullptr) return (this->*shader.shade)(prim, point, normal, cache, ray, diff);
+	if (lightFalloff) return shadeKernel<true, true, true, 0, true>(prim, point, normal, cache, ray, diff);
+	return shadeKernel<true, true, false, 0, true>(prim, point, normal, cache, ray, diff);
+}
+
+glm::vec3 RenderScene::phong(const glm::vec3& p, const glm::vec3& norm, const glm::vec3& diffuse, const glm::vec3& specular, float power, ShadowCache* cache) const {
+	if (lightFalloff) return phongKernel<true, true, 0, 0, true>(p, norm, diffuse, specular, power, cache);
+	return phongKernel<true, false, 0, 0, true>(p, norm, diffuse, specular, power, cache);
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "scene.h"
+#include "rayPacket.h"
+#include "frameBuffer.h"
+#include "renderStats.h"
+#include "lightGrid.h"
+#include <deque>
+
+//  Material of a compiled object.  Textures point at the mipmapped textures of the
+//  source object, nothing is copied
+//
+struct Material {
+	ofColor diffuse;
+	ofColor specular;
+	const MipTexture* texture = nullptr;          // null if the object is not textured
+	const MipTexture* specularTexture = nullptr;
+	int textureFile = -1;                         // where the textures came from (index into
+	int specularTextureFile = -1;                 // RenderScene::textureFiles), -1 if unknown
+};
+
+//  What a camera sample hit, kept after a render so the sample can be shaded again
+//  without tracing it:  the primitive (-1 for the background, noSample for a slot
+//  nothing was traced into), the hit point and normal, and one bit per light that
+//  reaches the point.  Texture coordinates follow from the point
+//
+struct GSample {
+	enum { noSample = -2 };
+	static const int maxLights = 32;
+
+	int prim;
+	glm::vec3 point, normal;
+	uint32_t lit;
+};
+
+//  Per thread shadow state: what blocked the last shadow ray to each light.  Neighbouring
+//  shading points are usually blocked by the same thing, so it is tested first; it is
+//  only a guess, so a cache kept from another scene does no harm.  It also carries the
+//  thread's render counters, if anything is being counted
+//
+//  With visibility set, phong writes which lights reach the point into it, and with
+//  replay it reads them from it instead, tracing shadow rays only for the lights that
+//  retrace (null for none) flags
+//
+struct ShadowCache {
+	vector<int> lastOccluder;     // per light, -1 if nothing blocked its last shadow ray
+	RenderCounters* counters = nullptr;
+	uint32_t* visibility = nullptr;
+	bool replay = false;
+	const char* retrace = nullptr;
+
+	void reset(int numLights) { lastOccluder.assign(numLights, -1); }
+};
+
+//  Render scene
+//
+//  The SceneObject graph stays what the app edits.  Before every render it is compiled
+//  into this flat copy: spheres and planes as structure-of-arrays, one material per
+//  object, lights as arrays, and a BVH over all of it.  The trace and shade loops run
+//  over these arrays without pointer chasing or virtual calls, and since nothing here
+//  points back into live gui state the workers can read it while the app carries on.
+//
+//  Primitives are numbered spheres first, then axis aligned planes, then any other
+//  object type (which falls back to the virtual SceneObject interface).  Others
+//  without bounds come last and are not in the BVH.
+//
+class RenderScene {
+public:
+	void compile(const vector<SceneObject*>& scene, const vector<Light*>& lights, const RenderCam& cam);
+
+	// point the packet kernels at the arrays.  Done by compile; anything else that fills
+	// the arrays directly (see loadBinaryScene) calls it when it is done
+	//
+	void setupPacketScene();
+
+	// work out how far each light reaches, bin the lights into the light grid and pick
+	// the shading kernel.  Done by compile and loadBinaryScene; call it again after
+	// changing lightFalloff or lightCutoff
+	//
+	void setupLights();
+
+	// tracing
+	//
+	// du and dv are the size of a sample on the view plane (in the same 0..1 units as u
+	// and v).  They set how much texture filtering each sample gets.  Colors come back
+	// linear and unclamped (see linearColor)
+	//
+	// with counters, traceSamples counts its rays, tests and time in them, and with cost
+	// it also gives the nanoseconds spent on each sample.  With gsamples it keeps what
+	// each sample hit there (at most GSample::maxLights lights), and with prims just the
+	// primitive, -1 for none
+	//
+	// shadows keeps the last occluder of every light from one call to the next, so rows
+	// and passes over the same part of the image start from it.  Give each thread its own.
+	// Without it every call starts afresh
+	//
+	// reshadeSamples shades samples traced before from their gsamples again, for a scene
+	// that differs only in materials, texture tiling, background and lights.  Shadow rays
+	// are traced for the lights retrace flags (may be null), and gsamples updated.  Slots
+	// without a sample are skipped and their colors left alone
+	//
+	glm::vec3 traceSample(float u, float v, float du = 0, float dv = 0, ShadowCache* cache = nullptr) const;
+	void traceSamples(const float* u, const float* v, int n, float du, float dv, glm::vec3* colors,
+		RenderCounters* counters = nullptr, float* cost = nullptr, GSample* gsamples = nullptr, int* prims = nullptr, ShadowCache* shadows = nullptr) const;
+	void reshadeSamples(const float* u, const float* v, int n, float du, float dv, GSample* gsamples, const char* retrace,
+		glm::vec3* colors, RenderCounters* counters = nullptr, ShadowCache* shadows = nullptr) const;
+	int closestHit(const Ray& ray, glm::vec3& point, glm::vec3& normal, RenderCounters* counters = nullptr) const;
+	bool intersectPrim(int prim, const Ray& ray, glm::vec3& point, glm::vec3& normal) const;
+	bool inShadow(const Ray& ray) const;
+
+	// shadow query: is anything between p and light number light, in direction l.  Stops
+	// at the first occluder found.  cache may be null
+	//
+	bool occluded(const glm::vec3& p, const glm::vec3& l, int light, ShadowCache* cache) const;
+
+	// shading, in float:  lights add up without clamping, the framebuffer's resolve
+	// does that once at the end
+	//
+	// with the camera ray and its differentials, textures are filtered over the area the
+	// sample covers; without them they are point sampled
+	//
+	glm::vec3 shade(int prim, const glm::vec3& point, const glm::vec3& normal, ShadowCache* cache = nullptr,
+		const Ray* ray = nullptr, const RayDifferential* diff = nullptr) const;
+	glm::vec3 phong(const glm::vec3& p, const glm::vec3& norm, const glm::vec3& diffuse, const glm::vec3& specular, float power, ShadowCache* cache = nullptr) const;
+
+	// shading kernels:  shade and phong compiled for a set of scene features (see
+	// shadeKernel), with the Phong exponent the constant phongPower.  phongKernel takes
+	// it as Power, and only reads its power argument for Power 0, which is what phong()
+	// runs.  Only GBuffer kernels keep and replay the lights G-buffer samples see
+	//
+	// traceKernel and reshadeKernel are the sample loops of traceSamples and
+	// reshadeSamples with a shading kernel built in, so it is picked once a call rather
+	// than once a sample.  selectShader picks the kernels for the scene into shader,
+	// which shade, traceSamples and reshadeSamples run.  setupLights calls it
+	//
+	typedef glm::vec3 (RenderScene::*ShadeFunction)(int prim, const glm::vec3& point, const glm::vec3& normal,
+		ShadowCache* cache, const Ray* ray, const RayDifferential* diff) const;
+	typedef void (RenderScene::*TraceFunction)(const float* u, const float* v, int n, float du, float dv, glm::vec3* colors,
+		RenderCounters* counters, float* cost, GSample* gsamples, int* prims, ShadowCache* shadows) const;
+	typedef void (RenderScene::*ReshadeFunction)(const float* u, const float* v, int n, float du, float dv, GSample* gsamples,
+		const char* retrace, glm::vec3* colors, RenderCounters* counters, ShadowCache* shadows) const;
+	struct Kernels {
+		ShadeFunction shade = nullptr;
+		TraceFunction trace = nullptr;          // without gsamples
+		TraceFunction traceGBuffer = nullptr;   // with them
+		ReshadeFunction reshade = nullptr;
+	};
+	static const int phongPower = 1000;
+	template<bool Textured, bool Shadows, bool Falloff, int NumLights, bool GBuffer>
+	glm::vec3 shadeKernel(int prim, const glm::vec3& point, const glm::vec3& normal, ShadowCache* cache,
+		const Ray* ray, const RayDifferential* diff) const;
+	template<bool Shadows, bool Falloff, int NumLights, int Power, bool GBuffer>
+	glm::vec3 phongKernel(const glm::vec3& p, const glm::vec3& norm, const glm::vec3& diffuse, const glm::vec3& specular, float power, ShadowCache* cache) const;
+	template<bool Textured, bool Shadows, bool Falloff, int NumLights, bool GBuffer>
+	void traceKernel(const float* u, const float* v, int n, float du, float dv, glm::vec3* colors,
+		RenderCounters* counters, float* cost, GSample* gsamples, int* prims, ShadowCache* shadows) const;
+	template<bool Textured, bool Shadows, bool Falloff, int NumLights>
+	void reshadeKernel(const float* u, const float* v, int n, float du, float dv, GSample* gsamples,
+		const char* retrace, glm::vec3* colors, RenderCounters* counters, ShadowCache* shadows) const;
+	void selectShader();
+	glm::vec2 texelCoords(int prim, const glm::vec3& point, const MipTexture& texture, bool specular) const;
+	glm::vec2 planeUV(int plane, const glm::vec3& point) const;
+	glm::vec2 planeUVChange(int plane, const glm::vec3& pointChange) const;
+	glm::vec3 filteredTexel(const MipTexture& texture, glm::vec2 uv, glm::vec2 duvdx, glm::vec2 duvdy) const;
+
+	int numSpheres() const { return sphereX.size(); }
+	int numPlanes() const { return planeAxis.size(); }
+	int numPrims() const { return primMaterial.size(); }
+	bool isSphere(int prim) const { return prim < numSpheres(); }
+	bool isPlane(int prim) const { return prim >= numSpheres() && prim < numSpheres() + numPlanes(); }
+
+	// render settings
+	//
+	ofColor background = ofColor::black;
+	int numTiles = 1;
+	bool usePackets = true;
+	bool filterTextures = true;     // trilinear mipmapped lookups; off gives the original point sampling
+	bool lightFalloff = false;      // inverse square light falloff; off gives the original constant one
+	float lightCutoff = 1.0f / 512; // with falloff:  contribution (0..1) below which a light is left out
+	RenderCam camera;
+
+	// spheres
+	//
+	vector<float> sphereX, sphereY, sphereZ;
+	vector<float> sphereRadius;
+
+	// axis aligned planes.  planePlacement is laid out for the packet kernels (see
+	// PacketScene), the rest is what shading and texture mapping need
+	//
+	vector<int> planeAxis;
+	vector<float> planePlacement;
+	vector<glm::vec3> planePosition;
+	vector<glm::vec3> planeNormal;
+	vector<float> planeWidth, planeHeight;
+
+	// everything else
+	//
+	vector<SceneObject*> others;
+	int numBounded = 0;             // primitives [0, numBounded) are in the BVH
+
+	// per primitive
+	//
+	vector<int> primMaterial;
+	vector<char> primCastsShadow;       // planes do not
+	vector<SceneObject*> primObject;    // source object, for the app; not used while tracing
+	vector<Material> materials;
+	std::deque<MipTexture> textures;    // textures of scenes that were not compiled from objects
+	vector<string> textureFiles;
+
+	// lights
+	//
+	vector<glm::vec3> lightPosition;
+	vector<float> lightIntensity;
+	vector<float> lightRadius;          // beyond it a light adds nothing, infinite without falloff
+	LightGrid lightGrid;                // with falloff, the lights that reach each part of the scene
+
+	// shading
+	//
+	Kernels shader;
+	string shaderName;                  // the features shader was compiled for
+
+	BVH bvh;
+	PacketScene packetScene;
+};
@@ -0,0 +1,133 @@
+#include "renderStats.h"
+#include <fstream>
+#include <map>
+
+void RenderCounters::add(const RenderCounters& c) {
+	primaryRays += c.primaryRays;
+	shadowRays += c.shadowRays;
+	sphereTests += c.sphereTests;
+	planeTests += c.planeTests;
+	otherTests += c.otherTests;
+	boxTests += c.boxTests;
+	textureFetches += c.textureFetches;
+	traceNanos += c.traceNanos;
+	shadeNanos += c.shadeNanos;
+}
+
+void RenderStats::begin(int numWorkers, int w, int h, bool heatmap) {
+	workers.clear();
+	workers.resize(numWorkers + 1);
+	width = w;
+	height = h;
+	costs.assign(heatmap ? size_t(w) * h : 0, 0.0f);
+	startTime = std::chrono::steady_clock::now();
+}
+
+RenderCounters RenderStats::total() const {
+	RenderCounters sum;
+	for (const Worker& worker : workers) sum.add(worker.counters);
+	return sum;
+}
+
+static void writeCounters(std::ostream& out, const RenderCounters& c, const string& indent) {
+	out << indent << "\"primary_rays\": " << c.primaryRays << "," << endl
+		<< indent << "\"shadow_rays\": " << c.shadowRays << "," << endl
+		<< indent << "\"sphere_tests\": " << c.sphereTests << "," << endl
+		<< indent << "\"plane_tests\": " << c.planeTests << "," << endl
+		<< indent << "\"other_tests\": " << c.otherTests << "," << endl
+		<< indent << "\"box_tests\": " << c.boxTests << "," << endl
+		<< indent << "\"texture_fetches\": " << c.textureFetches << "," << endl
+		<< indent << "\"trace_ms\": " << c.traceNanos / 1e6 << "," << endl
+		<< indent << "\"shade_ms\": " << c.shadeNanos / 1e6 << endl;
+}
+
+// totals, the time spent in each kind of event (passes, resample, encode...), and the
+// counters of every worker
+//
+bool RenderStats::writeSummary(const string& path) const {
+	std::ofstream out(ofToDataPath(path, true));
+	if (!out) return false;
+
+	std::map<string, uint64_t> phases;
+	uint64_t end = 0;
+	for (const Worker& worker : workers) {
+		for (const Event& e : worker.events) {
+			phases[e.name] += e.end - e.start;
+			end = std::max(end, e.end);
+		}
+	}
+
+	out << "{" << endl;
+	out << "  \"width\": " << width << "," << endl;
+	out << "  \"height\": " << height << "," << endl;
+	out << "  \"workers\": " << (int)workers.size() - 1 << "," << endl;
+	out << "  \"elapsed_ms\": " << end / 1e3 << "," << endl;
+	out << "  \"total\": {" << endl;
+	writeCounters(out, total(), "    ");
+	out << "  }," << endl;
+	out << "  \"phases_ms\": {" << endl;
+	for (auto it = phases.begin(); it != phases.end(); ++it) {
+		out << "    \"" << it->first << "\": " << it->second / 1e3 << (std::next(it) != phases.end() ? "," : "") << endl;
+	}
+	out << "  }," << endl;
+	out << "  \"per_worker\": [" << endl;
+	for (int i = 0; i < workers.size(); i++) {
+		out << "    {" << endl;
+		writeCounters(out, workers[i].counters, "      ");
+		out << "    }" << (i + 1 < workers.size() ? "," : "") << endl;
+	}
+	out << "  ]" << endl;
+	out << "}" << endl;
+	return bool(out);
+}
+
+// Chrome trace event format:  one complete ("X") event per span, one thread per worker
+//
+bool RenderStats::writeTrace(const string& path) const {
+	std::ofstream out(ofToDataPath(path, true));
+	if (!out) return false;
+	out << "{\"traceEvents\": [" << endl;
+	bool first = true;
+	for (int i = 0; i < workers.size(); i++) {
+		string thread = i == getMainWorker() ? "app" : "worker " + ofToString(i);
+		out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << i
+			<< ", \"args\": {\"name\": \"" << thread << "\"}}";
+		first = false;
+		for (const Event& e : workers[i].events) {
+			out << ",\n{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << i
+				<< ", \"ts\": " << e.start << ", \"dur\": " << e.end - e.start << "}";
+		}
+	}
+	out << endl << "]}" << endl;
+	return bool(out);
+}
+
+// cost on a log scale, from the cheapest pixel to the 99th percentile, through black,
+// purple, red and yellow to white
+//
+bool RenderStats::writeHeatmap(const string& path) const {
+	if (costs.empty()) return false;
+	vector<float> sorted;
+	for (float c : costs) {
+		if (c > 0) sorted.push_back(c);
+	}
+	if (sorted.empty()) return false;
+	std::sort(sorted.begin(), sorted.end());
+	float lo = logf(sorted.front());
+	float hi = logf(sorted[size_t(0.99 * (sorted.size() - 1))]);
+
+	static const glm::vec3 ramp[] = { glm::vec3(0, 0, 0), glm::vec3(0.4f, 0, 0.6f), glm::vec3(0.9f, 0.1f, 0.1f), glm::vec3(1, 0.8f, 0), glm::vec3(1, 1, 1) };
+	ofPixels pixels;
+	pixels.allocate(width, height, OF_IMAGE_COLOR);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			float c = costs[size_t(y) * width + x];
+			float t = c > 0 && hi > lo ? ofClamp((logf(c) - lo) / (hi - lo), 0, 1) : 0;
+			float f = t * 4;
+			int k = std::min(int(f), 3);
+			glm::vec3 color = ramp[k] + (f - k) * (ramp[k + 1] - ramp[k]);
+			pixels.setColor(x, y, ofColor(color.x * 255, color.y * 255, color.z * 255));
+		}
+	}
+	return ofSaveImage(pixels, path);
+}
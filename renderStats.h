@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ofMain.h"
+#include <chrono>
+
+//  What one thread did while rendering.  Intersection tests count ray / primitive
+//  pairs, so a packet test of a sphere counts once for every ray in the packet
+//
+struct RenderCounters {
+	uint64_t primaryRays = 0;
+	uint64_t shadowRays = 0;
+	uint64_t sphereTests = 0;
+	uint64_t planeTests = 0;
+	uint64_t otherTests = 0;
+	uint64_t boxTests = 0;           // BVH node boxes
+	uint64_t textureFetches = 0;
+	uint64_t traceNanos = 0;         // finding the closest hits
+	uint64_t shadeNanos = 0;         // shading them, shadow rays included
+
+	void add(const RenderCounters& c);
+};
+
+//  Render statistics
+//
+//  Counters, a timeline and optionally a per pixel cost map of one render.  Every
+//  worker of the pool has its own counters and event list, padded apart, so the
+//  workers record without locks or shared cache lines; they are only added up when
+//  the results are written.  Work on the app's thread (resampling, encoding) goes in
+//  under the extra worker number getMainWorker().
+//
+//  The results are written as a JSON summary, as a Chrome trace event file (load it
+//  in chrome://tracing or ui.perfetto.dev) and as a heatmap image.
+//
+class RenderStats {
+public:
+	// start collecting for a render of w x h pixels on numWorkers pool threads
+	//
+	void begin(int numWorkers, int w, int h, bool heatmap);
+	bool isActive() const { return !workers.empty(); }
+	int getMainWorker() const { return workers.size() - 1; }
+
+	RenderCounters& counters(int worker) { return workers[worker].counters; }
+
+	// microseconds since begin(), the time base of the events
+	//
+	uint64_t now() const {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	// one span of work on a worker's timeline
+	//
+	void event(int worker, const string& name, uint64_t start, uint64_t end) {
+		workers[worker].events.push_back({ name, start, end });
+	}
+
+	// nanoseconds spent on each pixel, null without a heatmap.  Rows run top to bottom,
+	// and workers only write the pixels of their own tiles
+	//
+	float* pixelCost() { return costs.empty() ? nullptr : costs.data(); }
+
+	RenderCounters total() const;
+
+	bool writeSummary(const string& path) const;
+	bool writeTrace(const string& path) const;
+	bool writeHeatmap(const string& path) const;
+
+private:
+	struct Event {
+		string name;
+		uint64_t start, end;
+	};
+	struct alignas(64) Worker {
+		RenderCounters counters;
+		vector<Event> events;
+	};
+
+	vector<Worker> workers;
+	std::chrono::steady_clock::time_point startTime;
+	int width = 0, height = 0;
+	vector<float> costs;
+};
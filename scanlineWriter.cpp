@@ -0,0 +1,172 @@
+#include "scanlineWriter.h"
+#include <cstring>
+
+// float to IEEE half, rounding to nearest.  Too large becomes infinity, too small zero
+//
+static uint16_t toHalf(float f) {
+	uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+	uint32_t sign = (x >> 16) & 0x8000;
+	uint32_t mantissa = x & 0x7fffff;
+	int exponent = int((x >> 23) & 0xff);
+	if (exponent == 0xff) return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);   // inf, nan
+	exponent += 15 - 127;
+	if (exponent >= 31) return sign | 0x7c00;
+	if (exponent <= 0) {         // denormal
+		if (exponent < -10) return sign;
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t h = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1) h++;
+		return sign | h;
+	}
+	uint32_t h = sign | (exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000) h++;  // a carry out of the mantissa correctly bumps the exponent
+	return h;
+}
+
+// OpenEXR is little endian whatever the machine, so everything goes through these
+//
+static void putBytes(string& s, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) s.push_back(char((value >> (8 * i)) & 0xff));
+}
+
+static void putAttribute(string& header, const string& name, const string& type, const string& value) {
+	header += name;
+	header.push_back(0);
+	header += type;
+	header.push_back(0);
+	putBytes(header, value.size(), 4);
+	header += value;
+}
+
+// OpenEXR:  single part scanline file, uncompressed, half float B, G, R channels (the
+// format wants them sorted by name), one scanline per block.  Blocks are all the same
+// size, so the offset table is known up front
+//
+static string exrHeader(int width, int height) {
+	string channels;
+	for (const char* name : { "B", "G", "R" }) {
+		channels += name;
+		channels.push_back(0);
+		putBytes(channels, 1, 4);     // HALF
+		putBytes(channels, 0, 4);     // pLinear and reserved
+		putBytes(channels, 1, 4);     // x sampling
+		putBytes(channels, 1, 4);     // y sampling
+	}
+	channels.push_back(0);
+
+	string window;
+	putBytes(window, 0, 4);
+	putBytes(window, 0, 4);
+	putBytes(window, width - 1, 4);
+	putBytes(window, height - 1, 4);
+
+	float one = 1;
+	uint32_t oneBits;
+	memcpy(&oneBits, &one, sizeof(oneBits));
+	string aspect, center(8, '\0'), screenWidth;
+	putBytes(aspect, oneBits, 4);
+	putBytes(screenWidth, oneBits, 4);
+
+	string header;
+	putBytes(header, 20000630, 4);   // magic
+	putBytes(header, 2, 4);          // version 2, single part scanline
+	putAttribute(header, "channels", "chlist", channels);
+	putAttribute(header, "compression", "compression", string(1, '\0'));
+	putAttribute(header, "dataWindow", "box2i", window);
+	putAttribute(header, "displayWindow", "box2i", window);
+	putAttribute(header, "lineOrder", "lineOrder", string(1, '\0'));
+	putAttribute(header, "pixelAspectRatio", "float", aspect);
+	putAttribute(header, "screenWindowCenter", "v2f", center);
+	putAttribute(header, "screenWindowWidth", "float", screenWidth);
+	header.push_back(0);
+
+	// offset table, then the blocks:  y, byte count, and the channels one after another
+	//
+	uint64_t blockSize = 8 + 3 * 2 * uint64_t(width);
+	uint64_t firstBlock = header.size() + 8 * uint64_t(height);
+	for (int y = 0; y < height; y++) putBytes(header, firstBlock + y * blockSize, 8);
+	return header;
+}
+
+ScanlineWriter::Format ScanlineWriter::formatOf(const string& path) {
+	string ext = ofToLower(ofFilePath::getFileExt(path));
+	if (ext == "ppm") return PPM;
+	if (ext == "pfm") return PFM;
+	if (ext == "exr") return EXR;
+	return NONE;
+}
+
+bool ScanlineWriter::canWrite(const string& path) {
+	return formatOf(path) != NONE;
+}
+
+bool ScanlineWriter::open(const string& path, int w, int h, const ToneMap& toneMap) {
+	close();
+	format = formatOf(path);
+	if (format == NONE || w < 1 || h < 1) return false;
+	file.open(ofToDataPath(path, true), std::ios::binary);
+	if (!file) return false;
+	width = w;
+	height = h;
+	rowsWritten = 0;
+	this->toneMap = toneMap;
+
+	if (format == PPM) file << "P6\n" << width << " " << height << "\n255\n";
+	else if (format == PFM) {
+		// the sign of the scale gives the byte order, negative is little endian
+		uint16_t order = 1;
+		bool littleEndian = *(const unsigned char*)&order == 1;
+		file << "PF\n" << width << " " << height << "\n" << (littleEndian ? "-1.0" : "1.0") << "\n";
+	}
+	else {
+		string header = exrHeader(width, height);
+		file.write(header.data(), header.size());
+	}
+	return bool(file);
+}
+
+bool ScanlineWriter::write(const FrameBuffer& image, int first, int last) {
+	if (!file.is_open() || image.getWidth() != width || first < 0 || last > image.getHeight() || last - first > height - rowsWritten) return false;
+	if (isBottomUp()) {
+		for (int y = last - 1; y >= first; y--) writeRow(image, y);
+	}
+	else {
+		for (int y = first; y < last; y++) writeRow(image, y);
+	}
+	return bool(file);
+}
+
+void ScanlineWriter::writeRow(const FrameBuffer& image, int y) {
+	row.clear();
+	if (format == PPM) {
+		row.resize(3 * size_t(width));
+		image.resolveRow(y, (unsigned char*)&row[0], toneMap);
+	}
+	else if (format == PFM) {
+		row.resize(3 * sizeof(float) * size_t(width));
+		for (int x = 0; x < width; x++) {
+			glm::vec3 c = image.getColor(x, y);
+			float rgb[3] = { c.x, c.y, c.z };
+			memcpy(&row[3 * sizeof(float) * x], rgb, sizeof(rgb));
+		}
+	}
+	else {
+		putBytes(row, rowsWritten, 4);
+		putBytes(row, 3 * 2 * uint64_t(width), 4);
+		for (int channel = 2; channel >= 0; channel--) {
+			for (int x = 0; x < width; x++) putBytes(row, toHalf(image.getColor(x, y)[channel]), 2);
+		}
+	}
+	file.write(row.data(), row.size());
+	rowsWritten++;
+}
+
+bool ScanlineWriter::close() {
+	if (!file.is_open()) return false;
+	bool complete = rowsWritten == height && bool(file);
+	file.close();
+	format = NONE;
+	return complete && !file.fail();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "frameBuffer.h"
+#include <fstream>
+
+//  Scanline image writer
+//
+//  Writes an image to disk a few rows at a time, for images too big to be held whole:
+//  the rows go out as they are handed in and nothing but one row is kept.  The format
+//  comes from the extension:
+//
+//    .ppm    8 bit binary RGB, tonemapped like FrameBuffer::resolve
+//    .pfm    float RGB, rows from the bottom up
+//    .exr    OpenEXR half float, uncompressed, one scanline per block
+//
+//  All three have rows of a fixed size, so the header (and the EXR offset table) can be
+//  written before the first pixel is known.  Rows must be handed in the order the file
+//  stores them:  from the top down, or from the bottom up for isBottomUp() formats.
+//
+class ScanlineWriter {
+public:
+	ScanlineWriter() {}
+	~ScanlineWriter() { close(); }
+	ScanlineWriter(const ScanlineWriter&) = delete;
+	ScanlineWriter& operator=(const ScanlineWriter&) = delete;
+
+	// create the file for a w x h image and write its header.  toneMap is only used for
+	// 8 bit formats
+	//
+	bool open(const string& path, int w, int h, const ToneMap& toneMap = ToneMap());
+
+	// write rows [first, last) of image (counted from the top, as in the framebuffer) as
+	// the next rows of the file.  image must be as wide as the file.  Returns false if
+	// the rows do not fit or cannot be written
+	//
+	bool write(const FrameBuffer& image, int first, int last);
+
+	// finish the file.  Returns false if it did not get all of its rows or could not be
+	// written
+	//
+	bool close();
+
+	bool isOpen() const { return file.is_open(); }
+	bool isBottomUp() const { return format == PFM; }
+	int getRowsWritten() const { return rowsWritten; }
+
+	static bool canWrite(const string& path);
+
+private:
+	enum Format { NONE, PPM, PFM, EXR };
+
+	static Format formatOf(const string& path);
+	void writeRow(const FrameBuffer& image, int y);
+
+	std::ofstream file;
+	Format format = NONE;
+	int width = 0, height = 0;
+	int rowsWritten = 0;
+	ToneMap toneMap;
+	string row;
+};
@@ -0,0 +1,121 @@
+// author: Vanessa Tang
+
+#include "scene.h"
+
+// Load both texture maps; the object is only textured if both load
+//
+bool SceneObject::loadTexture(const string& file, const string& specFile) {
+	ofImage theTexture, theSpec;
+	theTexture.setUseTexture(false);
+	theSpec.setUseTexture(false);
+	if (!theTexture.load(file) || !theSpec.load(specFile)) return false;
+	setTexture(theTexture);
+	setSpec(theSpec);
+	textureFile = ofToDataPath(file, true);
+	specularTextureFile = ofToDataPath(specFile, true);
+	return true;
+}
+
+// Intersect Ray with Plane  (wrapper on glm::intersect*)
+//
+bool Plane::intersect(const Ray& ray, glm::vec3& point, glm::vec3&
+	normalAtIntersect) {
+	float dist;
+	bool insidePlane = false;
+	bool hit = glm::intersectRayPlane(ray.p, ray.d, position, this->normal,
+		dist);
+	if (hit) {
+		Ray r = ray;
+		point = r.evalPoint(dist);
+		normalAtIntersect = this->normal;
+		glm::vec2 xrange = glm::vec2(position.x - width / 2, position.x + width
+			/ 2);
+		glm::vec2 yrange = glm::vec2(position.y - width / 2, position.y + width
+			/ 2);
+		glm::vec2 zrange = glm::vec2(position.z - height / 2, position.z +
+			height / 2);
+		// horizontal 
+		//
+		if (normal == glm::vec3(0, 1, 0) || normal == glm::vec3(0, -1, 0)) {
+			if (point.x < xrange[1] && point.x > xrange[0] && point.z <
+				zrange[1] && point.z > zrange[0]) {
+				insidePlane = true;
+			}
+		}
+		// front or back
+		//
+		else if (normal == glm::vec3(0, 0, 1) || normal == glm::vec3(0, 0, -1))
+		{
+			if (point.x < xrange[1] && point.x > xrange[0] && point.y <
+				yrange[1] && point.y > yrange[0]) {
+				insidePlane = true;
+			}
+		}
+		// left or right
+		//
+		else if (normal == glm::vec3(1, 0, 0) || normal == glm::vec3(-1, 0, 0))
+		{
+			if (point.y < yrange[1] && point.y > yrange[0] && point.z <
+				zrange[1] && point.z > zrange[0]) {
+				insidePlane = true;
+			}
+		}
+	}
+	return insidePlane;
+}
+
+// Bounds of the plane rectangle, matching the ranges tested in Plane::intersect.
+// The box is given a little thickness along the normal so rays never slip between
+// the two (coincident) slabs
+//
+bool Plane::getBounds(AABB& bounds) {
+	float eps = .001;
+	glm::vec3 halfSize;
+	if (normal == glm::vec3(0, 1, 0) || normal == glm::vec3(0, -1, 0))
+		halfSize = glm::vec3(width / 2, eps, height / 2);
+	else if (normal == glm::vec3(0, 0, 1) || normal == glm::vec3(0, 0, -1))
+		halfSize = glm::vec3(width / 2, width / 2, eps);
+	else if (normal == glm::vec3(1, 0, 0) || normal == glm::vec3(-1, 0, 0))
+		halfSize = glm::vec3(eps, width / 2, height / 2);
+	else
+		return false;
+	bounds = AABB(position - halfSize, position + halfSize);
+	return true;
+}
+
+// Convert (u, v) to (x, y, z) 
+// We assume u,v is in [0, 1]
+//
+glm::vec3 ViewPlane::toWorld(float u, float v) const {
+	float w = width();
+	float h = height();
+	return (glm::vec3((u * w) + min.x, (v * h) + min.y, position.z));
+}
+
+// Get a ray from the current camera position to the (u, v) position on
+// the ViewPlane
+//
+Ray RenderCam::getRay(float u, float v) const {
+	glm::vec3 pointOnPlane = view.toWorld(u, v);
+	if (oriented) return Ray(position, glm::normalize(orientation * (pointOnPlane - position)));
+	return(Ray(position, glm::normalize(pointOnPlane - position)));
+}
+
+// Differentiate d = normalize(q), q = pointOnPlane - position:  a change dq in the
+// point on the view plane turns the direction by (dq - d (d . dq)) / |q|
+//
+Ray RenderCam::getRay(float u, float v, float du, float dv, RayDifferential& diff) const {
+	glm::vec3 q = view.toWorld(u, v) - position;
+	glm::vec3 dqx = glm::vec3(view.width() * du, 0, 0);
+	glm::vec3 dqy = glm::vec3(0, view.height() * dv, 0);
+	if (oriented) {
+		q = orientation * q;
+		dqx = orientation * dqx;
+		dqy = orientation * dqy;
+	}
+	float len = glm::length(q);
+	glm::vec3 d = glm::normalize(q);
+	diff.dDdx = (dqx - d * glm::dot(d, dqx)) / len;
+	diff.dDdy = (dqy - d * glm::dot(d, dqy)) / len;
+	return getRay(u, v);
+}
@@ -0,0 +1,346 @@
+// author: Vanessa Tang
+
+#pragma once
+
+#include "ofMain.h"
+#include <glm/gtx/intersect.hpp>
+#include "bvh.h"
+#include "mipTexture.h"
+
+//  General Purpose Ray class 
+//
+class Ray {
+public:
+	Ray() {}
+	Ray(glm::vec3 p, glm::vec3 d) { this->p = p; this->d = d; }
+	void draw(float t) { ofDrawLine(p, p + t * d); }
+
+	glm::vec3 evalPoint(float t) {
+		return (p + t * d);
+	}
+
+	glm::vec3 p, d;
+};
+
+//  How the direction of a camera ray changes from one pixel to the next, in x and y.
+//  Used to work out how much of a texture a pixel covers
+//
+struct RayDifferential {
+	glm::vec3 dDdx = glm::vec3(0);
+	glm::vec3 dDdy = glm::vec3(0);
+};
+
+//  Base class for any renderable object in the scene
+//
+//  The destructor would stop the compiler from making the move operations, so they
+//  are asked for.  Objects are moved into the SceneStore's pools, and a move keeps
+//  the images (and their GL textures) and the geometry where they are
+//
+class SceneObject {
+public:
+	SceneObject() {}
+	SceneObject(const SceneObject&) = default;
+	SceneObject(SceneObject&&) = default;
+	SceneObject& operator=(const SceneObject&) = default;
+	SceneObject& operator=(SceneObject&&) = default;
+	virtual ~SceneObject() {}
+	virtual void draw() = 0;    // pure virtual funcs - must be overloaded
+	virtual bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) { cout << "SceneObject::intersect" << endl; return false; }
+
+	// true if the ray hits the object anywhere, for shadow rays.  Objects that can
+	// answer that faster than finding the closest hit override it
+	//
+	virtual bool intersectAny(const Ray& ray) { glm::vec3 point, normal; return intersect(ray, point, normal); }
+
+	// world space bounds used to build the BVH.  Objects that return false have no
+	// finite bounds and are tested against every ray
+	//
+	virtual bool getBounds(AABB& bounds) { return false; }
+
+	//texture stuff
+	virtual ofColor getColor(glm::vec3 point) {
+		return ofColor::pink;
+	}
+	virtual glm::vec2 getIJCoords(glm::vec3 point, int numTiles) {
+		return glm::vec2(0, 0);
+	}
+	virtual glm::vec2 getIJCoordsSpec(glm::vec3 point, int numTiles) {
+		return glm::vec2(0, 0);
+	}
+
+	// any data common to all scene objects goes here
+	glm::vec3 position = glm::vec3(0, 0, 0);
+
+	// texture stuff.  The ray tracer samples mipmapped copies made here
+	void setTexture(const ofImage& theTexture) {
+		texture = theTexture;
+		textured = true;
+		mipTexture = make_shared<MipTexture>(texture.getPixels());
+	}
+	void setSpec(const ofImage& theSpec) {
+		specularTexture = theSpec;
+		mipSpecularTexture = make_shared<MipTexture>(specularTexture.getPixels());
+	}
+
+	// load the texture and specular map from files.  The ray tracer only reads their
+	// pixels, so no GL texture is made and this works without a window
+	//
+	bool loadTexture(const string& file, const string& specFile);
+
+	// UI parameters
+	bool isSelectable = true;
+
+	// material properties (we will ultimately replace this with a Material class - TBD)
+	//
+	ofColor diffuseColor = ofColor::grey;    // default colors - can be changed.
+	ofColor specularColor = ofColor::lightGray;
+	bool textured = false;
+	ofImage texture;
+	ofImage specularTexture;
+	shared_ptr<MipTexture> mipTexture;
+	shared_ptr<MipTexture> mipSpecularTexture;
+	string textureFile;            // absolute paths of the texture files, for saving the scene
+	string specularTextureFile;
+	string name = "SceneObject";
+};
+
+// adds float intensity to SceneObject
+class Light : public SceneObject {
+public:
+	Light(glm::vec3 p, float i) {
+		position = p;
+		intensity = i;
+		name = "light";
+	}
+
+	Light() {
+		name = "light";
+	}
+
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+		return (glm::intersectRaySphere(ray.p, ray.d, position, radius, point, normal));
+	}
+
+	void draw() {
+		ofSetColor(ofColor::darkRed);
+		ofDrawSphere(position, .1);
+	}
+
+	glm::vec3 getPosition() {
+		return position;
+	}
+
+	float getIntensity() {
+		return intensity;
+	}
+	void setIntensity(float theI) {
+		intensity = theI;
+	}
+
+	float intensity = 0;
+	float radius = 0.1;
+};
+
+//  General purpose sphere  (assume parametric)
+//
+class Sphere : public SceneObject {
+public:
+	Sphere(glm::vec3 p, float r, ofColor diffuse = ofColor::lightGray) { position = p; radius = r; diffuseColor = diffuse; name = "sphere"; }
+	Sphere() {
+		name = "sphere";
+	}
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+		return (glm::intersectRaySphere(ray.p, ray.d, position, radius, point, normal));
+	}
+	void draw() {
+		ofDrawSphere(position, radius);
+	}
+	bool getBounds(AABB& bounds) {
+		bounds = AABB(position - glm::vec3(radius), position + glm::vec3(radius));
+		return true;
+	}
+	void setRadius(float theR) {
+		radius = theR;
+	}
+
+	float radius = 1.0;
+};
+
+//  General purpose plane 
+//
+class Plane : public SceneObject {
+public:
+	Plane(glm::vec3 p, glm::vec3 n, ofColor diffuse = ofColor::green, float w =
+		20, float h = 20) {
+		position = p; normal = n;
+		width = w;
+		height = h;
+		diffuseColor = diffuse;
+		isSelectable = false;
+		if (normal == glm::vec3(0, 1, 0))
+			plane.rotateDeg(-90, 1, 0, 0);
+		else if (normal == glm::vec3(0, -1, 0))
+			plane.rotateDeg(90, 1, 0, 0);
+		else if (normal == glm::vec3(1, 0, 0))
+			plane.rotateDeg(90, 0, 1, 0);
+		else if (normal == glm::vec3(-1, 0, 0))
+			plane.rotateDeg(-90, 0, 1, 0);
+	}
+	Plane() {
+		normal = glm::vec3(0, 1, 0);
+		plane.rotateDeg(90, 1, 0, 0);
+		isSelectable = false;
+	}
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal);
+	bool getBounds(AABB& bounds);
+	float sdf(const glm::vec3& p);
+	glm::vec3 getNormal(const glm::vec3& p) { return this->normal; }
+	void draw() {
+		plane.setPosition(position);
+		plane.setWidth(width);
+		plane.setHeight(height);
+		plane.setResolution(4, 4);
+		// plane.drawWireframe();
+		plane.draw();
+	}
+
+	// get the IJ coords from the intersection point
+	//
+	glm::vec2 getIJCoords(glm::vec3 point, int numTiles) {
+		float planeWidth = this->width;
+		float planeHeight = this->height;
+		float u;
+		float v;
+
+		// map u
+		u = ofMap(point.x, position.x - (planeWidth / 2), position.x + (planeWidth / 2), 0.0, 1.0);
+
+		// map v depending on the normal
+		// ground
+		if (this->normal == glm::vec3(0, 1, 0)) {
+			v = ofMap(point.z, position.z - (planeHeight / 2), position.z + (planeHeight / 2), 0.0, 1.0);
+		}
+
+		// wall
+		if (this->normal == glm::vec3(0, 0, 1)) {
+			v = ofMap(point.y, position.y - (planeHeight / 2), position.y + (planeHeight / 2), 0.0, 1.0);
+		}
+		u = u * numTiles;
+		v = v * numTiles;
+
+		// get the IJ coord from u and v
+		float textureWidth = texture.getWidth();
+		float textureHeight = texture.getHeight();
+		int i = fmod(u * textureWidth - 0.5, textureWidth);
+		int j = fmod(v * textureHeight - 0.5, textureHeight);
+
+		//cout << "texture U: " << u << " texture V: " << v << " texture X: " << x << " texture y: " << y << "\n";
+		return glm::vec2(i, j);
+	}
+
+	glm::vec2 getIJCoordsSpec(glm::vec3 point, int numTiles) {
+		float planeWidth = this->width;
+		float planeHeight = this->height;
+		float u;
+		float v;
+
+		u = ofMap(point.x, position.x - (planeWidth / 2), position.x + (planeWidth / 2), 0.0, 1.0);
+
+		// ground
+		if (this->normal == glm::vec3(0, 1, 0)) {
+			v = ofMap(point.z, position.z - (planeHeight / 2), position.z + (planeHeight / 2), 0.0, 1.0);
+		}
+
+		// wall
+		if (this->normal == glm::vec3(0, 0, 1)) {
+			v = ofMap(point.y, position.y - (planeHeight / 2), position.y + (planeHeight / 2), 0.0, 1.0);
+		}
+		u = u * numTiles;
+		v = v * numTiles;
+
+		float specWidth = specularTexture.getWidth();
+		float specHeight = specularTexture.getHeight();
+		int i = fmod(u * specWidth - 0.5, specWidth);
+		int j = fmod(v * specHeight - 0.5, specHeight);
+
+		//cout << "texture U: " << u << " texture V: " << v << " texture X: " << x << " texture y: " << y << "\n";
+		return glm::vec2(i, j);
+	}
+
+	ofPlanePrimitive plane;
+	glm::vec3 normal;
+	float width = 20;
+	float height = 20;
+};
+
+// view plane for render camera
+// 
+class  ViewPlane : public Plane {
+public:
+	ViewPlane(glm::vec2 p0, glm::vec2 p1) { min = p0; max = p1; }
+
+	ViewPlane() {                         // create reasonable defaults (6x4 aspect)
+		min = glm::vec2(-3, -2);
+		max = glm::vec2(3, 2);
+		position = glm::vec3(0, 0, 5);
+		normal = glm::vec3(0, 0, 1);      // viewplane currently limited to Z axis orientation
+	}
+
+	void setSize(glm::vec2 min, glm::vec2 max) { this->min = min; this->max = max; }
+	float getAspect() { return width() / height(); }
+
+	glm::vec3 toWorld(float u, float v) const;   //   (u, v) --> (x, y, z) [ world space ]
+
+	void draw() {
+		ofDrawRectangle(glm::vec3(min.x, min.y, position.z), width(), height());
+	}
+
+
+	float width() const {
+		return (max.x - min.x);
+	}
+	float height() const {
+		return (max.y - min.y);
+	}
+
+	// some convenience methods for returning the corners
+	//
+	glm::vec2 topLeft() { return glm::vec2(min.x, max.y); }
+	glm::vec2 topRight() { return max; }
+	glm::vec2 bottomLeft() { return min; }
+	glm::vec2 bottomRight() { return glm::vec2(max.x, min.y); }
+
+	glm::vec2 min, max;
+};
+
+//  render camera  - z axis aligned
+//
+class RenderCam : public SceneObject {
+public:
+	RenderCam() {
+		position = glm::vec3(0, 0, 10);
+		aim = glm::vec3(0, 0, -1);
+	}
+	Ray getRay(float u, float v) const;
+
+	// the same ray, and how its direction changes when u and v move by du and dv (one
+	// pixel, or one sample)
+	//
+	Ray getRay(float u, float v, float du, float dv, RayDifferential& diff) const;
+	void draw() { ofDrawBox(position, 1.0); };
+	void drawFrustum();
+
+	// the view plane is laid out for a camera looking down -z.  The orientation turns
+	// the whole view about position (its columns are where x, y and z end up), for
+	// cameras that look some other way, like the live preview through previewCam
+	//
+	void setOrientation(const glm::mat3& m) { orientation = m; oriented = m != glm::mat3(1.0f); }
+	bool isOriented() const { return oriented; }
+
+	glm::vec3 aim;
+	ViewPlane view;          // The camera viewplane, this is the view that we will render 
+
+private:
+	glm::mat3 orientation = glm::mat3(1.0f);
+	bool oriented = false;
+};
@@ -0,0 +1,384 @@
+#include "sceneBinary.h"
+#include "mappedFile.h"
+#include <fstream>
+#include <map>
+#include <tuple>
+#include <cstring>
+
+static const char binarySceneMagic[4] = { 'R', 'S', 'C', 'N' };
+static const uint32_t binarySceneByteOrder = 0x01020304;
+static const size_t sectionAlignment = 64;
+
+enum BinarySection {
+	SECTION_SPHERE_X, SECTION_SPHERE_Y, SECTION_SPHERE_Z, SECTION_SPHERE_RADIUS,
+	SECTION_PLANE_AXIS, SECTION_PLANE_PLACEMENT, SECTION_PLANE_POSITION, SECTION_PLANE_NORMAL,
+	SECTION_PLANE_WIDTH, SECTION_PLANE_HEIGHT,
+	SECTION_PRIM_MATERIAL, SECTION_MATERIALS, SECTION_STRINGS,
+	SECTION_LIGHT_POSITION, SECTION_LIGHT_INTENSITY,
+	SECTION_BVH_NODES, SECTION_BVH_PRIM_INDICES,
+	NUM_SECTIONS
+};
+
+struct BinarySceneHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t numSpheres, numPlanes, numMaterials, numLights, numNodes;
+	int32_t numTiles;
+	uint8_t background[4];
+	float cameraPosition[3], cameraAim[3];
+	float viewMin[2], viewMax[2], viewZ;
+	uint32_t reserved;
+	uint64_t sectionOffset[NUM_SECTIONS];
+	uint64_t sectionSize[NUM_SECTIONS];
+};
+
+// texture names are byte offsets into the string section, -1 for none
+//
+struct BinaryMaterial {
+	uint8_t diffuse[4];
+	uint8_t specular[4];
+	int32_t textureName;
+	int32_t specularTextureName;
+};
+
+static_assert(sizeof(glm::vec3) == 12, "scene files store vec3 as 3 packed floats");
+static_assert(sizeof(BVHNode) == 32, "scene files store BVH nodes as 8 packed 32 bit values");
+
+bool isBinarySceneFile(const string& path) {
+	return ofToLower(ofFilePath::getFileExt(path)) == "rscn";
+}
+
+//--------------------------------------------------------------
+// writing
+//
+static void writeSection(ofstream& out, BinarySceneHeader& header, int section, const void* data, size_t size) {
+	static const char zeros[sectionAlignment] = {};
+	size_t pos = out.tellp();
+	size_t padding = (sectionAlignment - pos % sectionAlignment) % sectionAlignment;
+	out.write(zeros, padding);
+	header.sectionOffset[section] = pos + padding;
+	header.sectionSize[section] = size;
+	if (size) out.write((const char*)data, size);
+}
+
+template<typename T>
+static void writeSection(ofstream& out, BinarySceneHeader& header, int section, const vector<T>& v) {
+	writeSection(out, header, section, v.data(), v.size() * sizeof(T));
+}
+
+bool saveBinaryScene(const string& path, const RenderScene& scene, string& error) {
+	if (scene.numPrims() != scene.numSpheres() + scene.numPlanes()) {
+		error = "binary scenes can only hold spheres and axis aligned planes";
+		return false;
+	}
+	ofstream out(path, ios::binary);
+	if (!out) {
+		error = "cannot create " + path;
+		return false;
+	}
+
+	// the compiled scene has a material per object.  Identical ones are stored once
+	//
+	vector<BinaryMaterial> materials;
+	vector<int> primMaterial(scene.numPrims());
+	string strings;
+	map<string, int> stringOffsets;
+	auto addString = [&](int file) {
+		if (file < 0) return -1;
+		string name = relativeScenePath(path, scene.textureFiles[file]);
+		auto found = stringOffsets.find(name);
+		if (found != stringOffsets.end()) return found->second;
+		int offset = strings.size();
+		strings += name;
+		strings += '\0';
+		stringOffsets[name] = offset;
+		return offset;
+	};
+	map<tuple<int, int, int, int, int, int, int, int>, int> materialIndex;
+	vector<int> remap(scene.materials.size());
+	for (int i = 0; i < scene.materials.size(); i++) {
+		const Material& m = scene.materials[i];
+		BinaryMaterial bm = { { m.diffuse.r, m.diffuse.g, m.diffuse.b, m.diffuse.a },
+			{ m.specular.r, m.specular.g, m.specular.b, m.specular.a }, -1, -1 };
+		bm.textureName = addString(m.textureFile);
+		bm.specularTextureName = addString(m.specularTextureFile);
+		auto key = make_tuple(bm.diffuse[0], bm.diffuse[1], bm.diffuse[2], bm.specular[0], bm.specular[1], bm.specular[2], bm.textureName, bm.specularTextureName);
+		auto found = materialIndex.find(key);
+		if (found == materialIndex.end()) {
+			found = materialIndex.insert(make_pair(key, (int)materials.size())).first;
+			materials.push_back(bm);
+		}
+		remap[i] = found->second;
+	}
+	for (int prim = 0; prim < scene.numPrims(); prim++) primMaterial[prim] = remap[scene.primMaterial[prim]];
+
+	BinarySceneHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, binarySceneMagic, 4);
+	header.version = binarySceneVersion;
+	header.byteOrder = binarySceneByteOrder;
+	header.numSpheres = scene.numSpheres();
+	header.numPlanes = scene.numPlanes();
+	header.numMaterials = materials.size();
+	header.numLights = scene.lightPosition.size();
+	header.numNodes = scene.bvh.nodes.size();
+	header.numTiles = scene.numTiles;
+	header.background[0] = scene.background.r;
+	header.background[1] = scene.background.g;
+	header.background[2] = scene.background.b;
+	header.background[3] = scene.background.a;
+	const RenderCam& cam = scene.camera;
+	for (int i = 0; i < 3; i++) {
+		header.cameraPosition[i] = cam.position[i];
+		header.cameraAim[i] = cam.aim[i];
+	}
+	header.viewMin[0] = cam.view.min.x;
+	header.viewMin[1] = cam.view.min.y;
+	header.viewMax[0] = cam.view.max.x;
+	header.viewMax[1] = cam.view.max.y;
+	header.viewZ = cam.view.position.z;
+
+	// header first as a placeholder, rewritten once the section offsets are known
+	//
+	out.write((const char*)&header, sizeof(header));
+	writeSection(out, header, SECTION_SPHERE_X, scene.sphereX);
+	writeSection(out, header, SECTION_SPHERE_Y, scene.sphereY);
+	writeSection(out, header, SECTION_SPHERE_Z, scene.sphereZ);
+	writeSection(out, header, SECTION_SPHERE_RADIUS, scene.sphereRadius);
+	writeSection(out, header, SECTION_PLANE_AXIS, scene.planeAxis);
+	writeSection(out, header, SECTION_PLANE_PLACEMENT, scene.planePlacement);
+	writeSection(out, header, SECTION_PLANE_POSITION, scene.planePosition);
+	writeSection(out, header, SECTION_PLANE_NORMAL, scene.planeNormal);
+	writeSection(out, header, SECTION_PLANE_WIDTH, scene.planeWidth);
+	writeSection(out, header, SECTION_PLANE_HEIGHT, scene.planeHeight);
+	writeSection(out, header, SECTION_PRIM_MATERIAL, primMaterial);
+	writeSection(out, header, SECTION_MATERIALS, materials);
+	writeSection(out, header, SECTION_STRINGS, strings.data(), strings.size());
+	writeSection(out, header, SECTION_LIGHT_POSITION, scene.lightPosition);
+	writeSection(out, header, SECTION_LIGHT_INTENSITY, scene.lightIntensity);
+	writeSection(out, header, SECTION_BVH_NODES, scene.bvh.nodes);
+	writeSection(out, header, SECTION_BVH_PRIM_INDICES, scene.bvh.primIndices);
+	out.seekp(0);
+	out.write((const char*)&header, sizeof(header));
+
+	if (!out) {
+		error = "cannot write " + path;
+		return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+// loading
+//
+class SectionReader {
+public:
+	SectionReader(const MappedFile& file, const BinarySceneHeader& header) : file(file), header(header) {}
+
+	// point at section s if it holds exactly count elements of T
+	//
+	template<typename T>
+	const T* get(int s, size_t count) {
+		uint64_t offset = header.sectionOffset[s], size = header.sectionSize[s];
+		if (size != count * sizeof(T) || offset % sectionAlignment != 0 || offset > file.size() || size > file.size() - offset) {
+			ok = false;
+			return nullptr;
+		}
+		return (const T*)(file.data() + offset);
+	}
+
+	template<typename T>
+	void copy(int s, size_t count, vector<T>& v) {
+		const T* p = get<T>(s, count);
+		if (p != nullptr) v.assign(p, p + count);
+	}
+
+	bool ok = true;
+
+private:
+	const MappedFile& file;
+	const BinarySceneHeader& header;
+};
+
+bool loadBinaryScene(const string& path, RenderScene& scene, string& error, bool loadTextures) {
+	MappedFile file;
+	if (!file.open(path)) {
+		error = "cannot open " + path;
+		return false;
+	}
+	BinarySceneHeader header;
+	if (file.size() < sizeof(header)) {
+		error = path + " is not a scene file";
+		return false;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, binarySceneMagic, 4) != 0) {
+		error = path + " is not a scene file";
+		return false;
+	}
+	if (header.byteOrder != binarySceneByteOrder) {
+		error = path + " was written on a machine of the other byte order";
+		return false;
+	}
+	if (header.version != binarySceneVersion) {
+		error = path + " is version " + ofToString((int)header.version) + ", this build reads version " + ofToString((int)binarySceneVersion);
+		return false;
+	}
+
+	size_t numPrims = size_t(header.numSpheres) + header.numPlanes;
+	SectionReader sections(file, header);
+	sections.copy(SECTION_SPHERE_X, header.numSpheres, scene.sphereX);
+	sections.copy(SECTION_SPHERE_Y, header.numSpheres, scene.sphereY);
+	sections.copy(SECTION_SPHERE_Z, header.numSpheres, scene.sphereZ);
+	sections.copy(SECTION_SPHERE_RADIUS, header.numSpheres, scene.sphereRadius);
+	sections.copy(SECTION_PLANE_AXIS, header.numPlanes, scene.planeAxis);
+	sections.copy(SECTION_PLANE_PLACEMENT, 5 * size_t(header.numPlanes), scene.planePlacement);
+	sections.copy(SECTION_PLANE_POSITION, header.numPlanes, scene.planePosition);
+	sections.copy(SECTION_PLANE_NORMAL, header.numPlanes, scene.planeNormal);
+	sections.copy(SECTION_PLANE_WIDTH, header.numPlanes, scene.planeWidth);
+	sections.copy(SECTION_PLANE_HEIGHT, header.numPlanes, scene.planeHeight);
+	sections.copy(SECTION_PRIM_MATERIAL, numPrims, scene.primMaterial);
+	sections.copy(SECTION_LIGHT_POSITION, header.numLights, scene.lightPosition);
+	sections.copy(SECTION_LIGHT_INTENSITY, header.numLights, scene.lightIntensity);
+	sections.copy(SECTION_BVH_NODES, header.numNodes, scene.bvh.nodes);
+	sections.copy(SECTION_BVH_PRIM_INDICES, header.numNodes ? numPrims : 0, scene.bvh.primIndices);
+	const BinaryMaterial* materials = sections.get<BinaryMaterial>(SECTION_MATERIALS, header.numMaterials);
+	const char* strings = sections.get<char>(SECTION_STRINGS, header.sectionSize[SECTION_STRINGS]);
+	size_t stringsSize = header.sectionSize[SECTION_STRINGS];
+	if (!sections.ok) {
+		error = path + " is truncated or damaged";
+		return false;
+	}
+
+	// indices that the tracer follows without checking.  Children come after their
+	// parent, so the depths are known by the time a node is reached, and no node may be
+	// deeper than the traversal stacks allow
+	//
+	bool valid = true;
+	for (int m : scene.primMaterial) valid = valid && m >= 0 && m < header.numMaterials;
+	vector<int> depth(scene.bvh.nodes.size(), 0);
+	for (int i = 0; i < scene.bvh.nodes.size(); i++) {
+		const BVHNode& n = scene.bvh.nodes[i];
+		valid = valid && depth[i] <= BVH::maxDepth;
+		if (n.isLeaf()) valid = valid && n.leftFirst >= 0 && size_t(n.leftFirst) + n.count <= numPrims;
+		else if (n.leftFirst > i && n.leftFirst + 1 < scene.bvh.nodes.size()) {
+			depth[n.leftFirst] = std::max(depth[n.leftFirst], depth[i] + 1);
+			depth[n.leftFirst + 1] = std::max(depth[n.leftFirst + 1], depth[i] + 1);
+		}
+		else valid = false;
+	}
+	for (int prim : scene.bvh.primIndices) valid = valid && prim >= 0 && prim < numPrims;
+	for (int i = 0; i < header.numPlanes; i++) valid = valid && scene.planeAxis[i] >= 0 && scene.planeAxis[i] < 3;
+	for (int i = 0; i < header.numMaterials; i++) {
+		for (int32_t name : { materials[i].textureName, materials[i].specularTextureName }) {
+			valid = valid && name >= -1 && (name < 0 || (size_t(name) < stringsSize && memchr(strings + name, 0, stringsSize - name) != nullptr));
+		}
+	}
+	if (!valid) {
+		error = path + " is damaged";
+		return false;
+	}
+
+	// materials.  Each texture file is listed and loaded once
+	//
+	scene.textures.clear();
+	scene.textureFiles.clear();
+	map<int32_t, int> fileIndex;
+	vector<const MipTexture*> fileTextures;
+	auto textureFile = [&](int32_t name) {
+		if (name < 0) return -1;
+		auto found = fileIndex.find(name);
+		if (found != fileIndex.end()) return found->second;
+		string file = resolveScenePath(path, strings + name);
+		const MipTexture* texture = nullptr;
+		ofPixels pixels;
+		if (loadTextures) {
+			if (ofLoadImage(pixels, file)) {
+				scene.textures.emplace_back(pixels);
+				texture = &scene.textures.back();
+			}
+			else ofLogWarning("loadBinaryScene") << "cannot load " << file;
+		}
+		scene.textureFiles.push_back(file);
+		fileTextures.push_back(texture);
+		return fileIndex[name] = scene.textureFiles.size() - 1;
+	};
+	scene.materials.resize(header.numMaterials);
+	for (int i = 0; i < header.numMaterials; i++) {
+		const BinaryMaterial& bm = materials[i];
+		Material& m = scene.materials[i];
+		m = Material();
+		m.diffuse = ofColor(bm.diffuse[0], bm.diffuse[1], bm.diffuse[2], bm.diffuse[3]);
+		m.specular = ofColor(bm.specular[0], bm.specular[1], bm.specular[2], bm.specular[3]);
+		m.textureFile = textureFile(bm.textureName);
+		m.specularTextureFile = textureFile(bm.specularTextureName);
+		if (m.textureFile >= 0 && m.specularTextureFile >= 0) {
+			m.texture = fileTextures[m.textureFile];
+			m.specularTexture = fileTextures[m.specularTextureFile];
+		}
+		if (m.texture == nullptr || m.specularTexture == nullptr) m.texture = m.specularTexture = nullptr;
+	}
+
+	scene.background = ofColor(header.background[0], header.background[1], header.background[2], header.background[3]);
+	scene.numTiles = header.numTiles;
+	scene.camera.position = glm::vec3(header.cameraPosition[0], header.cameraPosition[1], header.cameraPosition[2]);
+	scene.camera.aim = glm::vec3(header.cameraAim[0], header.cameraAim[1], header.cameraAim[2]);
+	scene.camera.view.min = glm::vec2(header.viewMin[0], header.viewMin[1]);
+	scene.camera.view.max = glm::vec2(header.viewMax[0], header.viewMax[1]);
+	scene.camera.view.position.z = header.viewZ;
+
+	scene.others.clear();
+	scene.primCastsShadow.assign(numPrims, 1);
+	fill(scene.primCastsShadow.begin() + header.numSpheres, scene.primCastsShadow.end(), 0);
+	scene.numBounded = numPrims;
+	scene.primObject.assign(numPrims, nullptr);
+	scene.setupPacketScene();
+	scene.setupLights();
+	return true;
+}
+
+bool loadRenderScene(const string& path, RenderScene& scene, SceneDescription& objects, string& error, bool loadTextures) {
+	if (isBinarySceneFile(path)) return loadBinaryScene(path, scene, error, loadTextures);
+
+	if (!loadSceneFile(path, objects, error)) return false;
+	scene.background = objects.background;
+	scene.numTiles = objects.numTiles;
+	scene.compile(objects.objects, objects.lights, objects.camera);
+	return true;
+}
+
+//--------------------------------------------------------------
+// back to objects
+//
+void describeScene(const RenderScene& scene, SceneDescription& desc, bool loadTextures) {
+	desc.background = scene.background;
+	desc.numTiles = scene.numTiles;
+	desc.camera = scene.camera;
+	for (int i = 0; i < scene.lightPosition.size(); i++) {
+		desc.lights.push_back(new Light(scene.lightPosition[i], scene.lightIntensity[i]));
+	}
+
+	for (int prim = 0; prim < scene.numSpheres() + scene.numPlanes(); prim++) {
+		SceneObject* obj;
+		if (scene.isSphere(prim)) {
+			obj = new Sphere(glm::vec3(scene.sphereX[prim], scene.sphereY[prim], scene.sphereZ[prim]), scene.sphereRadius[prim]);
+		}
+		else {
+			int i = prim - scene.numSpheres();
+			obj = new Plane(scene.planePosition[i], scene.planeNormal[i], ofColor::green, scene.planeWidth[i], scene.planeHeight[i]);
+		}
+		const Material& m = scene.materials[scene.primMaterial[prim]];
+		obj->diffuseColor = m.diffuse;
+		obj->specularColor = m.specular;
+		if (m.textureFile >= 0 && m.specularTextureFile >= 0) {
+			const string& file = scene.textureFiles[m.textureFile];
+			const string& specFile = scene.textureFiles[m.specularTextureFile];
+			if (!loadTextures || !obj->loadTexture(file, specFile)) {
+				obj->textureFile = file;
+				obj->specularTextureFile = specFile;
+			}
+		}
+		desc.objects.push_back(obj);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "renderScene.h"
+#include "sceneFile.h"
+
+//  Binary scene files (.rscn)
+//
+//  A compiled RenderScene written out as it sits in memory: a fixed header, then one
+//  section per array (spheres, planes, materials, lights, BVH), each 64 byte aligned.
+//  Loading maps the file and copies every section into its array in one go, so there
+//  is no per object parsing or allocation and the BVH does not have to be rebuilt.
+//
+//  The format is versioned; a file written by a different version or on a machine of
+//  the other byte order is refused rather than misread.  Only spheres and axis aligned
+//  planes can be stored.  Textures are stored as file names relative to the scene file.
+//
+static const uint32_t binarySceneVersion = 1;
+
+bool isBinarySceneFile(const string& path);
+
+// write a compiled scene.  Fails if it holds primitives other than spheres and planes
+//
+bool saveBinaryScene(const string& path, const RenderScene& scene, string& error);
+
+// load into scene, ready to trace.  Textures are only loaded if loadTextures is set
+//
+bool loadBinaryScene(const string& path, RenderScene& scene, string& error, bool loadTextures = true);
+
+// load a text or binary scene file (by extension) ready to trace.  A text scene is
+// compiled from the objects it describes, which are left in objects and have to
+// outlive scene
+//
+bool loadRenderScene(const string& path, RenderScene& scene, SceneDescription& objects, string& error, bool loadTextures = true);
+
+// rebuild editable objects from a scene, for the app and for writing a text file.  With
+// loadTextures off, textured objects keep only their texture file names
+//
+void describeScene(const RenderScene& scene, SceneDescription& desc, bool loadTextures = true);
@@ -0,0 +1,284 @@
+#include "sceneFile.h"
+#include "mesh.h"
+#include "instance.h"
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <limits>
+
+void SceneDescription::clear() {
+	for (SceneObject* obj : objects) delete obj;
+	for (Light* light : lights) delete light;
+	objects.clear();
+	lights.clear();
+}
+
+static bool readColor(istringstream& in, ofColor& color) {
+	int r, g, b;
+	if (!(in >> r >> g >> b)) return false;
+	color = ofColor(ofClamp(r, 0, 255), ofClamp(g, 0, 255), ofClamp(b, 0, 255));
+	return true;
+}
+
+static bool readVec(istringstream& in, glm::vec3& v) {
+	return bool(in >> v.x >> v.y >> v.z);
+}
+
+// texture files are looked up next to the scene file unless the path is absolute
+//
+string resolveScenePath(const string& sceneFile, const string& file) {
+	if (ofFilePath::isAbsolute(file)) return file;
+	return ofFilePath::join(ofFilePath::getEnclosingDirectory(sceneFile, false), file);
+}
+
+string relativeScenePath(const string& sceneFile, const string& file) {
+	return ofFilePath::makeRelative(ofFilePath::getEnclosingDirectory(sceneFile, false), file);
+}
+
+bool loadSceneFile(const string& path, SceneDescription& scene, string& error) {
+	ifstream file(path);
+	if (!file) {
+		error = "cannot open " + path;
+		return false;
+	}
+
+	SceneObject* current = nullptr;     // object the material lines apply to
+	map<string, shared_ptr<SceneObject>> models;
+	string line;
+	int lineNum = 0;
+	while (getline(file, line)) {
+		lineNum++;
+		size_t comment = line.find('#');
+		if (comment != string::npos) line.erase(comment);
+
+		istringstream in(line);
+		string keyword;
+		if (!(in >> keyword)) continue;
+
+		bool ok = true;
+		if (keyword == "background") {
+			ok = readColor(in, scene.background);
+		}
+		else if (keyword == "tiles") {
+			ok = bool(in >> scene.numTiles) && scene.numTiles > 0;
+		}
+		else if (keyword == "camera") {
+			ok = readVec(in, scene.camera.position) && readVec(in, scene.camera.aim);
+		}
+		else if (keyword == "view") {
+			ViewPlane& view = scene.camera.view;
+			ok = bool(in >> view.min.x >> view.min.y >> view.max.x >> view.max.y >> view.position.z);
+		}
+		else if (keyword == "light") {
+			glm::vec3 p;
+			float intensity;
+			ok = readVec(in, p) && bool(in >> intensity);
+			if (ok) scene.lights.push_back(new Light(p, intensity));
+		}
+		else if (keyword == "sphere") {
+			glm::vec3 p;
+			float radius;
+			ok = readVec(in, p) && bool(in >> radius);
+			if (ok) {
+				current = new Sphere(p, radius);
+				scene.objects.push_back(current);
+			}
+		}
+		else if (keyword == "plane") {
+			glm::vec3 p, n;
+			float w, h;
+			ok = readVec(in, p) && readVec(in, n) && bool(in >> w >> h);
+			if (ok) {
+				current = new Plane(p, n, ofColor::green, w, h);
+				scene.objects.push_back(current);
+			}
+		}
+		else if (keyword == "mesh") {
+			string meshFile;
+			glm::vec3 p;
+			float scale;
+			ok = bool(in >> meshFile) && readVec(in, p) && bool(in >> scale) && scale > 0;
+			if (ok) {
+				Mesh* mesh = new Mesh();
+				string meshError;
+				if (!mesh->load(resolveScenePath(path, meshFile), meshError)) {
+					delete mesh;
+					error = path + ":" + ofToString(lineNum) + ": " + meshError;
+					return false;
+				}
+				mesh->position = p;
+				mesh->scale = scale;
+				current = mesh;
+				scene.objects.push_back(current);
+			}
+		}
+		else if (keyword == "model") {
+			string name, meshFile;
+			ok = bool(in >> name >> meshFile);
+			if (ok) {
+				shared_ptr<Mesh> mesh = make_shared<Mesh>();
+				string meshError;
+				if (!mesh->load(resolveScenePath(path, meshFile), meshError)) {
+					error = path + ":" + ofToString(lineNum) + ": " + meshError;
+					return false;
+				}
+				mesh->name = name;
+				models[name] = mesh;
+				current = mesh.get();
+			}
+		}
+		else if (keyword == "instance") {
+			string name;
+			glm::vec3 p;
+			ok = bool(in >> name) && readVec(in, p);
+			if (ok && models.count(name) == 0) {
+				error = path + ":" + ofToString(lineNum) + ": no model " + name;
+				return false;
+			}
+			vector<float> m;
+			float x;
+			while (in >> x) m.push_back(x);
+			glm::mat3 linear(1.0f);
+			if (m.size() == 1) linear = glm::mat3(m[0]);
+			else if (m.size() == 9) {
+				for (int row = 0; row < 3; row++)
+					for (int col = 0; col < 3; col++) linear[col][row] = m[3 * row + col];
+			}
+			else ok = ok && m.empty();
+			ok = ok && glm::determinant(linear) != 0;
+			if (ok) {
+				current = new Instance(models[name], p, linear);
+				scene.objects.push_back(current);
+			}
+		}
+		else if (keyword == "diffuse" || keyword == "specular" || keyword == "texture") {
+			if (current == nullptr) {
+				error = path + ":" + ofToString(lineNum) + ": " + keyword + " before any object";
+				return false;
+			}
+			if (keyword == "diffuse") ok = readColor(in, current->diffuseColor);
+			else if (keyword == "specular") ok = readColor(in, current->specularColor);
+			else {
+				string textureFile, specFile;
+				ok = bool(in >> textureFile >> specFile);
+				if (ok && !current->loadTexture(resolveScenePath(path, textureFile), resolveScenePath(path, specFile))) {
+					error = path + ":" + ofToString(lineNum) + ": cannot load " + textureFile + " or " + specFile;
+					return false;
+				}
+			}
+		}
+		else {
+			error = path + ":" + ofToString(lineNum) + ": unknown keyword " + keyword;
+			return false;
+		}
+
+		if (!ok) {
+			error = path + ":" + ofToString(lineNum) + ": bad " + keyword + " line";
+			return false;
+		}
+	}
+	return true;
+}
+
+static void writeColor(ostream& out, const ofColor& c) {
+	out << int(c.r) << " " << int(c.g) << " " << int(c.b);
+}
+
+static void writeVec(ostream& out, const glm::vec3& v) {
+	out << v.x << " " << v.y << " " << v.z;
+}
+
+static void writeMaterial(ostream& out, const string& path, const SceneObject& obj, bool withTexture = true) {
+	out << "diffuse ";
+	writeColor(out, obj.diffuseColor);
+	out << "\nspecular ";
+	writeColor(out, obj.specularColor);
+	out << "\n";
+	if (withTexture && !obj.textureFile.empty())
+		out << "texture " << relativeScenePath(path, obj.textureFile) << " " << relativeScenePath(path, obj.specularTextureFile) << "\n";
+}
+
+bool saveSceneFile(const string& path, const SceneDescription& scene) {
+	ofstream out(path);
+	if (!out) return false;
+	out.precision(numeric_limits<float>::max_digits10);
+
+	out << "background ";
+	writeColor(out, scene.background);
+	out << "\ntiles " << scene.numTiles << "\n";
+
+	const RenderCam& cam = scene.camera;
+	out << "camera ";
+	writeVec(out, cam.position);
+	out << "  ";
+	writeVec(out, cam.aim);
+	out << "\nview " << cam.view.min.x << " " << cam.view.min.y << " " << cam.view.max.x << " "
+		<< cam.view.max.y << " " << cam.view.position.z << "\n\n";
+
+	for (Light* light : scene.lights) {
+		out << "light ";
+		writeVec(out, light->position);
+		out << " " << light->intensity << "\n";
+	}
+
+	// the models of the instances first, named in order
+	//
+	map<const SceneObject*, string> modelNames;
+	for (SceneObject* obj : scene.objects) {
+		Instance* instance = dynamic_cast<Instance*>(obj);
+		if (instance == nullptr || modelNames.count(instance->getPrototype().get())) continue;
+		Mesh* mesh = dynamic_cast<Mesh*>(instance->getPrototype().get());
+		if (mesh == nullptr) {
+			ofLogWarning("saveSceneFile") << "skipping " << obj->name << ", its model is not a mesh";
+			continue;
+		}
+		string name = "model" + ofToString(int(modelNames.size()) + 1);
+		modelNames[mesh] = name;
+		out << "\nmodel " << name << " " << relativeScenePath(path, mesh->file) << "\n";
+		writeMaterial(out, path, *mesh);
+	}
+
+	for (SceneObject* obj : scene.objects) {
+		if (Sphere* sphere = dynamic_cast<Sphere*>(obj)) {
+			out << "\nsphere ";
+			writeVec(out, sphere->position);
+			out << " " << sphere->radius << "\n";
+		}
+		else if (Plane* plane = dynamic_cast<Plane*>(obj)) {
+			out << "\nplane ";
+			writeVec(out, plane->position);
+			out << "  ";
+			writeVec(out, plane->normal);
+			out << "  " << plane->width << " " << plane->height << "\n";
+		}
+		else if (Mesh* mesh = dynamic_cast<Mesh*>(obj)) {
+			out << "\nmesh " << relativeScenePath(path, mesh->file) << " ";
+			writeVec(out, mesh->position);
+			out << " " << mesh->scale << "\n";
+		}
+		else if (Instance* instance = dynamic_cast<Instance*>(obj)) {
+			auto model = modelNames.find(instance->getPrototype().get());
+			if (model == modelNames.end()) continue;
+			out << "\ninstance " << model->second << " ";
+			writeVec(out, instance->position);
+			const glm::mat3& m = instance->getLinear();
+			if (m != glm::mat3(m[0][0])) {
+				for (int row = 0; row < 3; row++)
+					for (int col = 0; col < 3; col++) out << (col == 0 ? "  " : " ") << m[col][row];
+			}
+			else if (m[0][0] != 1) out << " " << m[0][0];
+			out << "\n";
+
+			// a texture line would load a copy of the model's texture
+			//
+			writeMaterial(out, path, *obj, instance->getPrototype()->mipTexture != obj->mipTexture);
+			continue;
+		}
+		else {
+			ofLogWarning("saveSceneFile") << "skipping " << obj->name << ", it has no scene file form";
+			continue;
+		}
+		writeMaterial(out, path, *obj);
+	}
+	return bool(out);
+}
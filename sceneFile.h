@@ -0,0 +1,55 @@
+#pragma once
+
+#include "scene.h"
+
+//  Scene files
+//
+//  A plain text description of everything that goes into a render, so a scene built in
+//  the app can be rendered again by the batch renderer and come out the same.  One
+//  statement per line, '#' starts a comment:
+//
+//    background r g b
+//    tiles n                                  texture repeats across a plane
+//    camera x y z  aimX aimY aimZ
+//    view minX minY maxX maxY z               view plane of the render camera
+//    light x y z intensity
+//    sphere x y z radius
+//    plane x y z  nx ny nz  width height
+//    mesh file x y z scale                    .obj or .ply, relative to the scene file
+//    model name file                          a mesh that is only placed by instances
+//    instance name x y z [s | m00 m01 ... m22]
+//                                             a copy of model name, scaled by s or
+//                                             transformed by a row major 3x3 matrix
+//
+//  Lines after a sphere, plane, mesh, model or instance set its material.  Instances
+//  start out with the material of their model:
+//
+//    diffuse r g b
+//    specular r g b
+//    texture file specularFile                relative to the scene file
+//
+struct SceneDescription {
+	vector<SceneObject*> objects;
+	vector<Light*> lights;
+	RenderCam camera;
+	ofColor background = ofColor::black;
+	int numTiles = 3;
+
+	// delete the objects and lights (only for descriptions that own them)
+	//
+	void clear();
+};
+
+// load path into scene, which should be empty.  On failure error says what and where
+//
+bool loadSceneFile(const string& path, SceneDescription& scene, string& error);
+
+// write scene out.  Floats are written with enough digits to read back exactly
+//
+bool saveSceneFile(const string& path, const SceneDescription& scene);
+
+// scene files name textures relative to themselves.  These convert between that and
+// paths the app can load
+//
+string resolveScenePath(const string& sceneFile, const string& file);
+string relativeScenePath(const string& sceneFile, const string& file);
@@ -0,0 +1,191 @@
+#include "sceneFootprint.h"
+
+bool SceneFootprint::Object::sameShape(const Object& o) const {
+	return object == o.object && bounded == o.bounded && bounds.min == o.bounds.min && bounds.max == o.bounds.max &&
+		position == o.position && castsShadow == o.castsShadow;
+}
+
+bool SceneFootprint::Object::sameMaterial(const Object& o) const {
+	return diffuse == o.diffuse && specular == o.specular && texture == o.texture && specularTexture == o.specularTexture;
+}
+
+static void boxCorners(const AABB& box, vector<glm::vec3>& corners) {
+	corners.clear();
+	for (int i = 0; i < 8; i++) {
+		corners.push_back(glm::vec3(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z));
+	}
+}
+
+void SceneFootprint::capture(const RenderScene& scene, const vector<ObjectHandle>& handles) {
+	clear();
+	bounds = AABB();
+	hasUnbounded = scene.numBounded < scene.numPrims();
+	for (int i = 0; i < scene.numPrims(); i++) {
+		SceneObject* obj = scene.primObject[i];
+		if (obj == nullptr || i >= int(handles.size()) || handles[i].isNull()) return;    // not compiled from objects, nothing to match
+		Object o;
+		o.object = handles[i];
+		o.bounded = i < scene.numBounded && obj->getBounds(o.bounds);
+		o.position = obj->position;
+		o.castsShadow = scene.primCastsShadow[i] != 0;
+		const Material& m = scene.materials[scene.primMaterial[i]];
+		o.diffuse = m.diffuse;
+		o.specular = m.specular;
+		o.texture = m.texture;
+		o.specularTexture = m.specularTexture;
+		if (o.bounded) bounds.grow(o.bounds);
+		objects.push_back(o);
+		primOrder.push_back(handles[i]);
+	}
+	std::sort(objects.begin(), objects.end(), [](const Object& a, const Object& b) { return a.object < b.object; });
+
+	cameraPosition = scene.camera.position;
+	viewMin = scene.camera.view.min;
+	viewMax = scene.camera.view.max;
+	viewZ = scene.camera.view.position.z;
+	cameraOriented = scene.camera.isOriented();
+	lightPosition = scene.lightPosition;
+	lightIntensity = scene.lightIntensity;
+	lightRadius = scene.lightRadius;
+	lightFalloff = scene.lightFalloff;
+	lightCutoff = scene.lightCutoff;
+	background = scene.background;
+	numTiles = scene.numTiles;
+	filterTextures = scene.filterTextures;
+	captured = true;
+}
+
+bool SceneFootprint::sameView(const SceneFootprint& after) const {
+	return cameraPosition == after.cameraPosition && viewMin == after.viewMin && viewMax == after.viewMax &&
+		viewZ == after.viewZ && viewZ != cameraPosition.z && !cameraOriented && !after.cameraOriented && lightPosition == after.lightPosition &&
+		lightIntensity == after.lightIntensity && background == after.background && numTiles == after.numTiles &&
+		filterTextures == after.filterTextures && lightFalloff == after.lightFalloff && lightCutoff == after.lightCutoff;
+}
+
+bool SceneFootprint::canReshade(const SceneFootprint& after, vector<char>& retraceLights) const {
+	retraceLights.clear();
+	if (!captured || !after.captured || primOrder != after.primOrder) return false;
+	if (!(cameraPosition == after.cameraPosition && viewMin == after.viewMin && viewMax == after.viewMax && viewZ == after.viewZ)) return false;
+	if (lightPosition.size() != after.lightPosition.size()) return false;
+	for (int i = 0; i < objects.size(); i++) {
+		if (!objects[i].sameShape(after.objects[i])) return false;
+	}
+	for (int i = 0; i < lightPosition.size(); i++) {
+		bool farther = i < lightRadius.size() && i < after.lightRadius.size() && after.lightRadius[i] > lightRadius[i];
+		retraceLights.push_back(lightPosition[i] != after.lightPosition[i] || farther);
+	}
+	return true;
+}
+
+// walk the two sorted object lists side by side and dirty every object that is not
+// in both, or differs.  A new material only shows on the object itself
+//
+bool SceneFootprint::findDirtyRegions(const SceneFootprint& after, int w, int h, vector<Tile>& regions) const {
+	regions.clear();
+	if (!captured || !after.captured || !sameView(after)) return false;
+
+	AABB sceneBounds = bounds;
+	sceneBounds.grow(after.bounds);
+	int i = 0, j = 0;
+	while (i < objects.size() || j < after.objects.size()) {
+		const Object* a = i < objects.size() ? &objects[i] : nullptr;
+		const Object* b = j < after.objects.size() ? &after.objects[j] : nullptr;
+		if (b == nullptr || (a != nullptr && a->object < b->object)) {
+			if (!addObject(*a, sceneBounds, true, w, h, regions)) return false;
+			i++;
+		}
+		else if (a == nullptr || b->object < a->object) {
+			if (!after.addObject(*b, sceneBounds, true, w, h, regions)) return false;
+			j++;
+		}
+		else {
+			if (!a->sameShape(*b)) {
+				if (!addObject(*a, sceneBounds, true, w, h, regions) || !after.addObject(*b, sceneBounds, true, w, h, regions)) return false;
+			}
+			else if (!a->sameMaterial(*b)) {
+				if (!addObject(*a, sceneBounds, false, w, h, regions)) return false;
+			}
+			i++;
+			j++;
+		}
+	}
+	return true;
+}
+
+// the screen bounds of the object's box, and with shadows of its shadows too.  False if
+// they cannot be bounded
+//
+bool SceneFootprint::addObject(const Object& o, const AABB& sceneBounds, bool shadows, int w, int h, vector<Tile>& regions) const {
+	if (!o.bounded) return false;
+	vector<glm::vec3> points;
+	boxCorners(o.bounds, points);
+	addScreenBounds(points, w, h, regions);
+	if (!shadows || !o.castsShadow || lightPosition.empty()) return true;
+	if (hasUnbounded) return false;    // the shadow may fall on them anywhere
+
+	// the shadow volume from light l is the box scaled about l by every factor from 1
+	// up.  Scaled by k, the nearest point of the box is as far from the light as the
+	// farthest corner of the scene, so nothing beyond that can be in the shadow, and the
+	// rest lies in the hull of the box and the box scaled by k
+	//
+	vector<glm::vec3> sceneCorners, boxPoints;
+	boxCorners(sceneBounds, sceneCorners);
+	boxCorners(o.bounds, boxPoints);
+	for (const glm::vec3& l : lightPosition) {
+		float nearest = glm::distance(l, glm::max(o.bounds.min, glm::min(l, o.bounds.max)));
+		if (nearest <= 0) return false;    // the light is inside the box
+		float farthest = 0;
+		for (const glm::vec3& c : sceneCorners) farthest = std::max(farthest, glm::distance(l, c));
+		float k = std::max(1.0f, farthest / nearest);
+		points = boxPoints;
+		for (const glm::vec3& c : boxPoints) points.push_back(l + k * (c - l));
+		addScreenBounds(points, w, h, regions);
+	}
+	return true;
+}
+
+// the pixels the convex hull of points covers, grown by a pixel.  The part of the hull
+// behind the camera is cut off first:  where the segments between points cross into it
+// is as far as anything can show
+//
+void SceneFootprint::addScreenBounds(const vector<glm::vec3>& points, int w, int h, vector<Tile>& regions) const {
+	// depth as a fraction of the way to the view plane, which is what to divide by to
+	// project onto it
+	//
+	const float nearDepth = 1e-6f;
+	float planeDistance = viewZ - cameraPosition.z;
+	vector<float> depth;
+	for (const glm::vec3& p : points) depth.push_back((p.z - cameraPosition.z) / planeDistance);
+
+	vector<glm::vec3> visible;
+	for (int a = 0; a < points.size(); a++) {
+		if (depth[a] < nearDepth) continue;
+		visible.push_back(points[a]);
+		for (int b = 0; b < points.size(); b++) {
+			if (depth[b] < nearDepth) {
+				float t = (depth[a] - nearDepth) / (depth[a] - depth[b]);
+				visible.push_back(points[a] + t * (points[b] - points[a]));
+			}
+		}
+	}
+	if (visible.empty()) return;
+
+	glm::vec2 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+	for (const glm::vec3& p : visible) {
+		float s = std::max(nearDepth, (p.z - cameraPosition.z) / planeDistance);
+		glm::vec2 q(cameraPosition.x + (p.x - cameraPosition.x) / s, cameraPosition.y + (p.y - cameraPosition.y) / s);
+		glm::vec2 pixel((q.x - viewMin.x) / (viewMax.x - viewMin.x) * w, (q.y - viewMin.y) / (viewMax.y - viewMin.y) * h);
+		lo = glm::min(lo, pixel);
+		hi = glm::max(hi, pixel);
+	}
+	Tile rect;
+	rect.x0 = int(floorf(ofClamp(lo.x, -2, w + 2))) - 1;
+	rect.y0 = int(floorf(ofClamp(lo.y, -2, h + 2))) - 1;
+	rect.x1 = int(floorf(ofClamp(hi.x, -2, w + 2))) + 2;
+	rect.y1 = int(floorf(ofClamp(hi.y, -2, h + 2))) + 2;
+	rect.x0 = std::max(rect.x0, 0);
+	rect.y0 = std::max(rect.y0, 0);
+	rect.x1 = std::min(rect.x1, w);
+	rect.y1 = std::min(rect.y1, h);
+	if (rect.x0 < rect.x1 && rect.y0 < rect.y1) regions.push_back(rect);
+}
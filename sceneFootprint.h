@@ -0,0 +1,85 @@
+#pragma once
+
+#include "renderScene.h"
+#include "sceneStore.h"
+#include "tileRenderer.h"
+
+//  Scene footprint
+//
+//  What a render of a RenderScene depended on, kept so that the render of an edited
+//  scene can work out which pixels the edit can have changed and trace only those.
+//  Objects are matched by their handle, not their address:  the store hands the slot
+//  of a deleted object to the next one of its type, but with a new generation.  An
+//  object that moved, changed shape, or came or went, dirties
+//
+//    - the screen bounds of its box, before and after the edit
+//    - if it casts shadows, the screen bounds of the shadow volume of its box from
+//      every light, cut off where it leaves the bounds of the scene
+//
+//  and one that only changed material dirties its own screen bounds.
+//
+//  Anything that can change every pixel (the camera, the lights, the render settings,
+//  an object without bounds) dirties the whole image.
+//
+//  It also tells when an edit leaves every camera ray hitting what it hit, so the last
+//  render can be shaded again from its G-buffer instead (see ProgressiveRenderer).
+//
+class SceneFootprint {
+public:
+	// handles[i] is the object primitive i of the scene was compiled from
+	//
+	void capture(const RenderScene& scene, const vector<ObjectHandle>& handles);
+	void clear() { captured = false; objects.clear(); primOrder.clear(); }
+	bool isEmpty() const { return !captured; }
+
+	// the pixels of a w x h render that can look different in a render of after than
+	// in a render of this, as rectangles in the tile coordinates of ProgressiveRenderer
+	// (rows counted from the bottom).  Returns false if that is every pixel
+	//
+	bool findDirtyRegions(const SceneFootprint& after, int w, int h, vector<Tile>& regions) const;
+
+	// true if a render of after only shades differently from a render of this:  the view,
+	// the primitives and their order are the same, and so is the number of lights.
+	// retraceLights flags the lights whose shadows need tracing again:  those that moved,
+	// and those that now reach points a render of this left them out at
+	//
+	bool canReshade(const SceneFootprint& after, vector<char>& retraceLights) const;
+
+private:
+	struct Object {
+		ObjectHandle object;
+		bool bounded;
+		AABB bounds;
+		glm::vec3 position;
+		bool castsShadow;
+		ofColor diffuse, specular;
+		const MipTexture* texture;
+		const MipTexture* specularTexture;
+
+		bool sameShape(const Object& o) const;        // what it covers and shadows
+		bool sameMaterial(const Object& o) const;
+	};
+
+	bool sameView(const SceneFootprint& after) const;
+	bool addObject(const Object& o, const AABB& sceneBounds, bool shadows, int w, int h, vector<Tile>& regions) const;
+	void addScreenBounds(const vector<glm::vec3>& points, int w, int h, vector<Tile>& regions) const;
+
+	bool captured = false;
+	vector<Object> objects;       // sorted by object
+	vector<ObjectHandle> primOrder;
+	AABB bounds;                  // of every bounded primitive
+	bool hasUnbounded = false;
+
+	glm::vec3 cameraPosition;
+	glm::vec2 viewMin, viewMax;
+	float viewZ = 0;
+	bool cameraOriented = false;  // the screen bounds below assume a camera looking down -z
+	vector<glm::vec3> lightPosition;
+	vector<float> lightIntensity;
+	vector<float> lightRadius;
+	bool lightFalloff = false;
+	float lightCutoff = 0;
+	ofColor background;
+	int numTiles = 1;
+	bool filterTextures = true;
+};
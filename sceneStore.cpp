@@ -0,0 +1,59 @@
+#include "sceneStore.h"
+
+// the loaders only make these types, so the casts run once per object a scene is
+// loaded with, never when it is looked up
+//
+ObjectHandle SceneStore::adopt(SceneObject* obj) {
+	ObjectHandle h;
+	if (Sphere* sphere = dynamic_cast<Sphere*>(obj)) h = add(std::move(*sphere));
+	else if (Plane* plane = dynamic_cast<Plane*>(obj)) h = add(std::move(*plane));
+	else if (Mesh* mesh = dynamic_cast<Mesh*>(obj)) h = add(std::move(*mesh));
+	else if (Instance* instance = dynamic_cast<Instance*>(obj)) h = add(std::move(*instance));
+	else if (Light* light = dynamic_cast<Light*>(obj)) h = add(std::move(*light));
+	if (!h.isNull()) delete obj;
+	return h;
+}
+
+SceneObject* SceneStore::get(const ObjectHandle& h) const {
+	switch (h.type) {
+	case ObjectHandle::SPHERE: return spheres.get(h.index, h.generation);
+	case ObjectHandle::PLANE: return planes.get(h.index, h.generation);
+	case ObjectHandle::MESH: return meshes.get(h.index, h.generation);
+	case ObjectHandle::INSTANCE: return instances.get(h.index, h.generation);
+	case ObjectHandle::LIGHT: return lightPool.get(h.index, h.generation);
+	default: return nullptr;
+	}
+}
+
+bool SceneStore::remove(const ObjectHandle& h) {
+	handles.erase(get(h));
+	version++;
+	switch (h.type) {
+	case ObjectHandle::SPHERE: return spheres.remove(h.index, h.generation);
+	case ObjectHandle::PLANE: return planes.remove(h.index, h.generation);
+	case ObjectHandle::MESH: return meshes.remove(h.index, h.generation);
+	case ObjectHandle::INSTANCE: return instances.remove(h.index, h.generation);
+	case ObjectHandle::LIGHT: return lightPool.remove(h.index, h.generation);
+	default: return false;
+	}
+}
+
+void SceneStore::clear() {
+	version++;
+	handles.clear();
+	spheres.clear();
+	planes.clear();
+	meshes.clear();
+	instances.clear();
+	lightPool.clear();
+}
+
+vector<SceneObject*> SceneStore::objects() const {
+	vector<SceneObject*> all;
+	all.reserve(spheres.size() + planes.size() + meshes.size() + instances.size());
+	all.insert(all.end(), spheres.objects().begin(), spheres.objects().end());
+	all.insert(all.end(), planes.objects().begin(), planes.objects().end());
+	all.insert(all.end(), meshes.objects().begin(), meshes.objects().end());
+	all.insert(all.end(), instances.objects().begin(), instances.objects().end());
+	return all;
+}
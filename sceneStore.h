@@ -0,0 +1,234 @@
+#pragma once
+
+#include "scene.h"
+#include "mesh.h"
+#include "instance.h"
+#include <new>
+#include <unordered_map>
+
+//  Handle to an object in a SceneStore
+//
+//  The slot the object lives in and the generation of that slot when it was put there.
+//  Deleting an object bumps the generation of its slot, so every handle to it goes null
+//  at once, even after the slot has been given to a new object.  The type says which
+//  pool the slot is in, so finding the object takes no search and no cast.
+//
+struct ObjectHandle {
+	enum Type { NONE, SPHERE, PLANE, MESH, INSTANCE, LIGHT };
+
+	Type type = NONE;
+	uint32_t index = 0;
+	uint32_t generation = 0;
+
+	bool isNull() const { return type == NONE; }
+	bool operator==(const ObjectHandle& h) const { return type == h.type && index == h.index && generation == h.generation; }
+	bool operator!=(const ObjectHandle& h) const { return !(*this == h); }
+	bool operator<(const ObjectHandle& h) const {
+		return type != h.type ? type < h.type : index != h.index ? index < h.index : generation < h.generation;
+	}
+};
+
+//  Object pool
+//
+//  Objects of one type in fixed size chunks of slots.  Objects never move once they are
+//  made, so pointers to them (the compiled RenderScene, the footprint of the last
+//  render) stay good for as long as they live.  Freed slots go on a free list and are
+//  handed out again before any new chunk is allocated, so a scene that keeps adding and
+//  deleting objects stays in the same memory.  The live objects are also kept packed in
+//  a list, in no particular order, for walking over all of them.
+//
+//  Adding, deleting and looking up by slot and generation are all constant time.
+//
+template <class T>
+class ObjectPool {
+public:
+	static const int chunkSize = 64;
+
+	ObjectPool() {}
+	~ObjectPool() { clear(); }
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	// make an object in a free slot.  index and generation are what its handle holds
+	//
+	template <class... Args>
+	T* emplace(uint32_t& index, uint32_t& generation, Args&&... args) {
+		if (freeSlot == noSlot) grow();
+		index = freeSlot;
+		Slot& slot = slots[index];
+		T* obj = new (address(index)) T(std::forward<Args>(args)...);
+		freeSlot = slot.next;
+		slot.live = int(live.size());
+		live.push_back(obj);
+		liveSlots.push_back(index);
+		generation = slot.generation;
+		return obj;
+	}
+
+	// the object, or null if it has been deleted
+	//
+	T* get(uint32_t index, uint32_t generation) const {
+		if (index >= slots.size()) return nullptr;
+		const Slot& slot = slots[index];
+		return slot.live >= 0 && slot.generation == generation ? live[slot.live] : nullptr;
+	}
+
+	// delete the object, filling its place in the live list with the last one
+	//
+	bool remove(uint32_t index, uint32_t generation) {
+		T* obj = get(index, generation);
+		if (obj == nullptr) return false;
+		Slot& slot = slots[index];
+		int last = int(live.size()) - 1;
+		live[slot.live] = live[last];
+		liveSlots[slot.live] = liveSlots[last];
+		slots[liveSlots[slot.live]].live = slot.live;
+		live.pop_back();
+		liveSlots.pop_back();
+		obj->~T();
+		release(index);
+		return true;
+	}
+
+	// delete every object.  The chunks are kept for the next ones
+	//
+	void clear() {
+		for (int k = 0; k < live.size(); k++) {
+			live[k]->~T();
+			release(liveSlots[k]);
+		}
+		live.clear();
+		liveSlots.clear();
+	}
+
+	const vector<T*>& objects() const { return live; }
+	int size() const { return live.size(); }
+
+	// slot and generation of objects()[k]
+	//
+	uint32_t slotOf(int k) const { return liveSlots[k]; }
+	uint32_t generationOf(int k) const { return slots[liveSlots[k]].generation; }
+
+private:
+	static const uint32_t noSlot = ~0u;
+
+	struct Slot {
+		uint32_t generation = 0;
+		uint32_t next = noSlot;   // free list
+		int live = -1;            // position in the live list, -1 while free
+	};
+	struct alignas(T) Storage {
+		unsigned char bytes[sizeof(T)];
+	};
+
+	T* address(uint32_t index) { return reinterpret_cast<T*>(&chunks[index / chunkSize][index % chunkSize]); }
+
+	void release(uint32_t index) {
+		Slot& slot = slots[index];
+		slot.live = -1;
+		slot.generation++;
+		slot.next = freeSlot;
+		freeSlot = index;
+	}
+
+	// a new chunk, its slots on the free list lowest first
+	//
+	void grow() {
+		uint32_t first = slots.size();
+		chunks.emplace_back(new Storage[chunkSize]);
+		slots.resize(first + chunkSize);
+		for (uint32_t i = first; i < first + chunkSize; i++) slots[i].next = i + 1 < first + chunkSize ? i + 1 : freeSlot;
+		freeSlot = first;
+	}
+
+	vector<unique_ptr<Storage[]>> chunks;
+	vector<Slot> slots;
+	uint32_t freeSlot = noSlot;
+	vector<T*> live;
+	vector<uint32_t> liveSlots;
+};
+
+//  Scene store
+//
+//  Owns the objects and lights of the app's scene, a pool per type, and hands out
+//  handles to them.  Code that keeps hold of an object between frames (the selection)
+//  keeps its handle, and gets null from get() once the object is gone rather than a
+//  pointer to freed memory.
+//
+class SceneStore {
+public:
+	ObjectHandle add(Sphere&& obj) { return insert(spheres, ObjectHandle::SPHERE, std::move(obj)); }
+	ObjectHandle add(Plane&& obj) { return insert(planes, ObjectHandle::PLANE, std::move(obj)); }
+	ObjectHandle add(Mesh&& obj) { return insert(meshes, ObjectHandle::MESH, std::move(obj)); }
+	ObjectHandle add(Instance&& obj) { return insert(instances, ObjectHandle::INSTANCE, std::move(obj)); }
+	ObjectHandle add(Light&& obj) { return insert(lightPool, ObjectHandle::LIGHT, std::move(obj)); }
+
+	// move an object made with new (by the scene loaders) into the store and delete it.
+	// Returns a null handle, and leaves obj alone, for types the store has no pool for
+	//
+	ObjectHandle adopt(SceneObject* obj);
+
+	SceneObject* get(const ObjectHandle& h) const;
+	bool remove(const ObjectHandle& h);
+
+	// the handle of a live object of the store, a null handle for anything else
+	//
+	ObjectHandle find(const SceneObject* obj) const {
+		auto it = handles.find(obj);
+		return it != handles.end() ? it->second : ObjectHandle();
+	}
+
+	void clear();
+
+	// counts the changes to the scene, so a copy compiled from it can tell it is out of
+	// date.  Adding and removing objects count themselves; code that changes an object
+	// in place calls touch()
+	//
+	uint64_t getVersion() const { return version; }
+	void touch() { version++; }
+
+	// the objects to render, lights apart, and the lights
+	//
+	vector<SceneObject*> objects() const;
+	const vector<Light*>& lights() const { return lightPool.objects(); }
+
+	// call f(handle, object) for every object, lights last
+	//
+	template <class F>
+	void forEach(F&& f) const {
+		visit(spheres, ObjectHandle::SPHERE, f);
+		visit(planes, ObjectHandle::PLANE, f);
+		visit(meshes, ObjectHandle::MESH, f);
+		visit(instances, ObjectHandle::INSTANCE, f);
+		visit(lightPool, ObjectHandle::LIGHT, f);
+	}
+
+private:
+	template <class T>
+	ObjectHandle insert(ObjectPool<T>& pool, ObjectHandle::Type type, T&& obj) {
+		ObjectHandle h;
+		h.type = type;
+		handles[pool.emplace(h.index, h.generation, std::move(obj))] = h;
+		version++;
+		return h;
+	}
+
+	template <class T, class F>
+	static void visit(const ObjectPool<T>& pool, ObjectHandle::Type type, F& f) {
+		for (int k = 0; k < pool.size(); k++) {
+			ObjectHandle h;
+			h.type = type;
+			h.index = pool.slotOf(k);
+			h.generation = pool.generationOf(k);
+			f(h, static_cast<SceneObject*>(pool.objects()[k]));
+		}
+	}
+
+	ObjectPool<Sphere> spheres;
+	ObjectPool<Plane> planes;
+	ObjectPool<Mesh> meshes;
+	ObjectPool<Instance> instances;
+	ObjectPool<Light> lightPool;
+	std::unordered_map<const SceneObject*, ObjectHandle> handles;   // of every live object
+	uint64_t version = 0;
+};
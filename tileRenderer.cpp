@@ -0,0 +1,122 @@
+#include "tileRenderer.h"
+#include <algorithm>
+
+std::vector<Tile> makeTiles(int w, int h, int tileSize) {
+	std::vector<Tile> tiles;
+	if (tileSize < 1) tileSize = 1;
+	for (int y = 0; y < h; y += tileSize) {
+		for (int x = 0; x < w; x += tileSize) {
+			tiles.push_back({ x, y, std::min(x + tileSize, w), std::min(y + tileSize, h) });
+		}
+	}
+	return tiles;
+}
+
+int ThreadPool::hardwareThreads() {
+	int n = (int)std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+ThreadPool::ThreadPool(int numThreads) {
+	start(numThreads > 0 ? numThreads : hardwareThreads());
+}
+
+ThreadPool::~ThreadPool() {
+	stop();
+}
+
+void ThreadPool::setNumThreads(int n) {
+	if (n < 1) n = hardwareThreads();
+	if (n == numThreads) return;
+	stop();
+	start(n);
+}
+
+void ThreadPool::start(int n) {
+	numThreads = n;
+	runs.reset(new TaskRun[n]);
+	quit = false;
+	generation = 0;
+
+	// worker 0 is whoever calls parallelFor
+	for (int i = 1; i < n; i++) {
+		threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+void ThreadPool::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto& t : threads) t.join();
+	threads.clear();
+}
+
+void ThreadPool::workerLoop(int worker) {
+	unsigned long seen = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+		runTasks(worker);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0) done.notify_one();
+		}
+	}
+}
+
+// drain our own run first, then go around the other workers and steal whatever is left
+//
+void ThreadPool::runTasks(int worker) {
+	for (int k = 0; k < numThreads; k++) {
+		TaskRun& run = runs[(worker + k) % numThreads];
+		for (int i = run.next.fetch_add(1); i < run.end; i = run.next.fetch_add(1)) {
+			(*job)(i, worker);
+		}
+	}
+}
+
+void ThreadPool::parallelFor(int numTasks, const std::function<void(int, int)>& task) {
+	if (numTasks <= 0) return;
+	if (numThreads == 1) {
+		for (int i = 0; i < numTasks; i++) task(i, 0);
+		return;
+	}
+
+	// deal the tasks out in contiguous runs
+	int begin = 0;
+	for (int w = 0; w < numThreads; w++) {
+		int count = numTasks / numThreads + (w < numTasks % numThreads ? 1 : 0);
+		runs[w].next.store(begin);
+		runs[w].end = begin + count;
+		begin += count;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &task;
+		busy = numThreads - 1;
+		generation++;
+	}
+	wake.notify_all();
+
+	runTasks(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [&] { return busy == 0; });
+	job = nullptr;
+}
+
+void renderTiles(ThreadPool& pool, int w, int h, int tileSize,
+	const std::function<void(const Tile&, int)>& renderTile) {
+	std::vector<Tile> tiles = makeTiles(w, h, tileSize);
+	pool.parallelFor((int)tiles.size(), [&](int i, int worker) {
+		renderTile(tiles[i], worker);
+	});
+}
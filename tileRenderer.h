@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+// A rectangular block of pixels [x0, x1) x [y0, y1) of the framebuffer
+//
+struct Tile {
+	int x0, y0, x1, y1;
+
+	int width() const { return x1 - x0; }
+	int height() const { return y1 - y0; }
+};
+
+// Split a w x h framebuffer into tiles of at most tileSize x tileSize, row by row
+//
+std::vector<Tile> makeTiles(int w, int h, int tileSize);
+
+//  Fixed pool of worker threads with work stealing
+//
+//  A job is a set of independent tasks.  The tasks are dealt out up front in
+//  contiguous runs, one run per worker; a worker that finishes its own run steals
+//  the remaining tasks of the others, so cheap tiles (sky) and expensive tiles
+//  (spheres, textures) still balance out.  The calling thread works as worker 0,
+//  so a pool of one thread runs everything serially on the caller.
+//
+class ThreadPool {
+public:
+	ThreadPool(int numThreads = 0);    // 0 = one thread per hardware core
+	~ThreadPool();
+
+	void setNumThreads(int n);
+	int getNumThreads() const { return numThreads; }
+
+	// run task(i, worker) for every i in [0, numTasks) and wait for all of them to finish
+	//
+	void parallelFor(int numTasks, const std::function<void(int, int)>& task);
+
+	static int hardwareThreads();
+
+private:
+	// tasks [next, end) still waiting in one worker's run.  padded to a cache line so
+	// that workers pulling from their own runs do not fight over the same line
+	//
+	struct alignas(64) TaskRun {
+		std::atomic<int> next{ 0 };
+		int end = 0;
+	};
+
+	void start(int n);
+	void stop();
+	void workerLoop(int worker);
+	void runTasks(int worker);
+
+	int numThreads = 1;
+	std::vector<std::thread> threads;
+	std::unique_ptr<TaskRun[]> runs;
+	const std::function<void(int, int)>* job = nullptr;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned long generation = 0;
+	int busy = 0;
+	bool quit = false;
+};
+
+// Render every tile of a w x h framebuffer on the pool.  renderTile(tile, worker) is
+// called exactly once per tile; tiles never overlap, so it can write its own pixels
+// straight into the output without any locking.
+//
+void renderTiles(ThreadPool& pool, int w, int h, int tileSize,
+	const std::function<void(const Tile&, int)>& renderTile);
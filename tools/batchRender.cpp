@@ -0,0 +1,171 @@
+//  Batch renderer
+//
+//  Renders a scene file (text, or binary .rscn) without a window or GL context, for
+//  scripted jobs on headless machines.  It runs the same RenderScene code as the app,
+//  so the image matches the app's render of the same scene:  -s 1 matches "Full Render", -s n matches the
+//  "MSAA Render" with anti-alias sample size n.
+//
+//  With a memory budget (-m) the image is rendered in bands of rows that fit in it and
+//  streamed to the output as they finish, so images far bigger than memory can be made.
+//  The pixels are the same as those of a render in one piece.
+//
+//  It is built by tools/Makefile, not with the app.  The exit status is non zero if the scene cannot be loaded or the
+//  image cannot be written.
+//
+
+#include "sceneBinary.h"
+#include "bandRenderer.h"
+
+static void usage() {
+	cerr << "usage: batchRender scene.txt|scene.rscn [options]" << endl
+		<< "  -o file     output image, format from the extension (default render.png).  .pfm" << endl
+		<< "              and .exr write the float image without tonemapping" << endl
+		<< "  -w width    image width (default 2400)" << endl
+		<< "  -h height   image height (default 1600)" << endl
+		<< "  -s n        n x n samples per pixel (default 1)" << endl
+		<< "  -a noise    adaptive sampling:  refine pixels while their noise is above this" << endl
+		<< "              (0..1, default 0 = every sample everywhere)" << endl
+		<< "  -t threads  render threads (default all hardware threads)" << endl
+		<< "  -f 0|1      filtered (mipmapped) textures (default 1)" << endl
+		<< "  -l cutoff   inverse square light falloff, leaving out lights whose contribution" << endl
+		<< "              (0..1) is below cutoff (default 0 = the original constant falloff)" << endl
+		<< "  -e exposure exposure before tonemapping (default 1)" << endl
+		<< "  -r 0|1      Reinhard tonemap instead of clipping (default 0)" << endl
+		<< "  -m MB       render in bands within this many megabytes of image memory and" << endl
+		<< "              stream them to the output, which must be .ppm, .pfm or .exr" << endl
+		<< "  -p prefix   write render statistics to prefix_stats.json, a Chrome trace to" << endl
+		<< "              prefix_trace.json and a cost heatmap to prefix_heatmap.png" << endl;
+}
+
+int main(int argc, char* argv[]) {
+	string scenePath, outPath = "render.png", statsPrefix;
+	int width = 2400, height = 1600;
+	int samples = 1;
+	int threads = ThreadPool::hardwareThreads();
+	int filter = 1;
+	float adaptive = 0;
+	float lightCutoff = 0;
+	int memoryBudget = 0;
+	ToneMap toneMap;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+			string value = argv[++i];
+			switch (arg[1]) {
+			case 'o': outPath = value; break;
+			case 'w': width = ofToInt(value); break;
+			case 'h': height = ofToInt(value); break;
+			case 's': samples = ofToInt(value); break;
+			case 'a': adaptive = ofToFloat(value); break;
+			case 't': threads = ofToInt(value); break;
+			case 'f': filter = ofToInt(value); break;
+			case 'l': lightCutoff = ofToFloat(value); break;
+			case 'e': toneMap.exposure = ofToFloat(value); break;
+			case 'r': toneMap.op = ofToInt(value) ? ToneMap::REINHARD : ToneMap::CLAMP; break;
+			case 'p': statsPrefix = value; break;
+			case 'm': memoryBudget = ofToInt(value); break;
+			default: usage(); return 2;
+			}
+		}
+		else if (arg[0] != '-' && scenePath.empty()) scenePath = arg;
+		else {
+			usage();
+			return 2;
+		}
+	}
+	if (scenePath.empty() || width < 1 || height < 1 || samples < 1 || threads < 1 || memoryBudget < 0) {
+		usage();
+		return 2;
+	}
+	if (memoryBudget > 0 && !ScanlineWriter::canWrite(outPath)) {
+		cerr << outPath << ": streamed images must be .ppm, .pfm or .exr" << endl;
+		return 2;
+	}
+	if (memoryBudget > 0 && !statsPrefix.empty()) {
+		cerr << "statistics are not collected for banded renders" << endl;
+		return 2;
+	}
+
+	// paths on the command line are relative to where we were started, not to a data folder
+	//
+	ofSetDataPathRoot(ofFilePath::getCurrentWorkingDirectory() + "/");
+
+	SceneDescription scene;
+	RenderScene renderScene;
+	string error;
+	uint64_t loadStart = ofGetElapsedTimeMillis();
+	if (!loadRenderScene(scenePath, renderScene, scene, error)) {
+		cerr << error << endl;
+		return 1;
+	}
+	cout << scenePath << ": " << renderScene.numPrims() << " primitives, loaded in " << ofGetElapsedTimeMillis() - loadStart << " ms" << endl;
+
+	renderScene.filterTextures = filter != 0;
+	renderScene.lightFalloff = lightCutoff > 0;
+	if (renderScene.lightFalloff) renderScene.lightCutoff = lightCutoff;
+	renderScene.setupLights();
+	cout << "shading kernel: " << renderScene.shaderName << endl;
+
+	ThreadPool pool(threads);
+	ProgressiveRenderer renderer(pool);
+	renderer.setCoarsePasses(false);
+	renderer.setToneMap(toneMap);
+	renderer.setAdaptive(adaptive);
+	if (memoryBudget > 0) {
+		BandRenderer bands(renderer);
+		bands.setMemoryBudget(size_t(memoryBudget) << 20);
+		string error;
+		if (!bands.render(&renderScene, width, height, samples, outPath, error)) {
+			cerr << error << endl;
+			return 1;
+		}
+		cout << outPath << ": " << width << "x" << height << ", " << samples << "x" << samples << " samples, "
+			<< bands.getNumBands() << " bands of up to " << bands.bandRows(width, samples) << " rows, "
+			<< bands.getRenderTime() << " ms, " << pool.getNumThreads() << " threads, "
+			<< bands.getSamplesTraced() << " samples" << endl;
+		scene.clear();
+		return 0;
+	}
+
+	RenderStats stats;
+	if (!statsPrefix.empty()) {
+		stats.begin(pool.getNumThreads(), width, height, true);
+		renderer.setStats(&stats);
+	}
+	renderer.start(&renderScene, width, height, samples);
+	renderer.wait();
+
+	uint64_t encodeStart = stats.now();
+	bool saved;
+	if (FrameBuffer::isHDRFile(outPath))
+		saved = renderer.getFrameBuffer().save(outPath);
+	else {
+		ofPixels pixels;
+		renderer.fetch(pixels);
+		saved = ofSaveImage(pixels, outPath);
+	}
+	if (!saved) {
+		cerr << "cannot write " << outPath << endl;
+		return 1;
+	}
+	cout << outPath << ": " << width << "x" << height << ", " << samples << "x" << samples << " samples, "
+		<< renderer.getRenderTime() << " ms, " << pool.getNumThreads() << " threads, "
+		<< renderer.getSamplesTraced() << " samples" << endl;
+
+	if (stats.isActive()) {
+		stats.event(stats.getMainWorker(), "encode", encodeStart, stats.now());
+		if (!stats.writeSummary(statsPrefix + "_stats.json") || !stats.writeTrace(statsPrefix + "_trace.json")
+			|| !stats.writeHeatmap(statsPrefix + "_heatmap.png")) {
+			cerr << "cannot write the statistics to " << statsPrefix << "_*" << endl;
+			return 1;
+		}
+		RenderCounters total = stats.total();
+		cout << statsPrefix << "_stats.json: " << total.primaryRays << " camera rays, " << total.shadowRays << " shadow rays, "
+			<< total.sphereTests + total.planeTests + total.otherTests << " primitive tests, " << total.boxTests << " box tests, "
+			<< total.textureFetches << " texture fetches" << endl;
+	}
+
+	scene.clear();
+	return 0;
+}
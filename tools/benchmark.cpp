@@ -0,0 +1,436 @@
+//  Benchmarks
+//
+//  Timings of the tracer core, to catch performance regressions:
+//
+//    - kernels:  Sphere::intersect and Plane::intersect, closest hit and shadow queries
+//      on the compiled scene, phong shading (ofApp::phong and ofApp::inShadow forward
+//      to RenderScene, which is what runs here), and packet tracing with every
+//      instruction set the CPU has
+//    - frames:  the scene ofApp::setup() builds, and random scenes of 1k, 10k, 100k
+//      and 1M spheres, compiled and rendered on all threads
+//
+//  Every benchmark repeats until it has run for a while and reports its fastest run,
+//  as ns per operation and operations (rays, intersections, shading points) per
+//  second.  -o writes the results as JSON, one benchmark per line; -b compares this
+//  run against such a file and exits with status 1 if anything got slower by more
+//  than the tolerance.
+//
+//  Like batchRender it is built by tools/Makefile, not with the app.
+//
+
+#include "progressiveRenderer.h"
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+struct BenchmarkResult {
+	string name;
+	string unit;             // what one operation is
+	uint64_t ops = 0;        // per run
+	double seconds = 0;      // fastest run
+	int runs = 0;
+	string detail;
+
+	double nsPerOp() const { return seconds * 1e9 / ops; }
+	double opsPerSecond() const { return ops / seconds; }
+};
+
+struct BenchmarkOptions {
+	string filter;           // only benchmarks whose name contains this
+	double minTime = 0.5;    // seconds per benchmark
+	bool quick = false;
+	int threads = ThreadPool::hardwareThreads();
+	int frameWidth = 1200, frameHeight = 800;
+	string dataPath;
+};
+
+static double now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// results go here so the compiler cannot drop the work being timed
+//
+static volatile uint64_t sink = 0;
+
+// run body (which does ops operations) until minTime has passed and at least 3 runs
+// are in, after one run to warm up
+//
+template<class Body>
+static BenchmarkResult measure(const BenchmarkOptions& options, const string& name, const string& unit, uint64_t ops, Body body) {
+	BenchmarkResult result;
+	result.name = name;
+	result.unit = unit;
+	result.ops = ops;
+	result.seconds = std::numeric_limits<double>::infinity();
+	body();
+	double start = now();
+	while (result.runs < 3 || now() - start < options.minTime) {
+		double runStart = now();
+		body();
+		result.seconds = std::min(result.seconds, now() - runStart);
+		result.runs++;
+	}
+	return result;
+}
+
+// random rays from around the camera position into the scene, about half of which hit
+// the test objects
+//
+static vector<Ray> randomRays(int n, std::mt19937& rng) {
+	std::uniform_real_distribution<float> unit(-1, 1);
+	vector<Ray> rays;
+	for (int i = 0; i < n; i++) {
+		glm::vec3 origin(unit(rng) * 2, 1 + unit(rng), 10);
+		glm::vec3 target(unit(rng) * 8, 1 + unit(rng) * 4, -4 + unit(rng) * 4);
+		rays.push_back(Ray(origin, glm::normalize(target - origin)));
+	}
+	return rays;
+}
+
+// the scene ofApp::setup() builds.  Without its textures the planes are plain
+//
+static void defaultScene(vector<SceneObject*>& scene, vector<Light*>& lights, bool& textured) {
+	Plane* groundPlane = new Plane(glm::vec3(0, -1, 0), glm::vec3(0, 1, 0), ofColor::aqua);
+	Plane* wallPlane = new Plane(glm::vec3(0, 0, -8), glm::vec3(0, 0, 1), ofColor::white);
+	textured = groundPlane->loadTexture("cobble.jpg", "cobblespec.jpg") && wallPlane->loadTexture("green.jpg", "greenspec.jpg");
+	scene.push_back(groundPlane);
+	scene.push_back(wallPlane);
+	scene.push_back(new Sphere(glm::vec3(-3, 1, -5), 2.0f, ofColor::darkCyan));
+	scene.push_back(new Sphere(glm::vec3(4, 1, 0), 1.0f, ofColor::darkGreen));
+	scene.push_back(new Sphere(glm::vec3(0, 1, 0), 2.0f, ofColor::darkKhaki));
+	lights.push_back(new Light(glm::vec3(-5, 3, 3), 40.0f));
+	lights.push_back(new Light(glm::vec3(0, 5, -1), 50.0f));
+	lights.push_back(new Light(glm::vec3(3, 2, 5), 50.0f));
+}
+
+// n random spheres over the ground plane, in the region the render camera sees.  The
+// radius shrinks with the count so the coverage of the frame stays about the same
+//
+static void sphereScene(int n, vector<SceneObject*>& scene, vector<Light*>& lights) {
+	std::mt19937 rng(n);
+	std::uniform_real_distribution<float> unit(0, 1);
+	float scale = cbrtf(1000.0f / n);
+	scene.push_back(new Plane(glm::vec3(0, -1, 0), glm::vec3(0, 1, 0), ofColor::aqua));
+	for (int i = 0; i < n; i++) {
+		glm::vec3 position(unit(rng) * 16 - 8, unit(rng) * 8 - 1, unit(rng) * 10 - 8);
+		ofColor color(unit(rng) * 255, unit(rng) * 255, unit(rng) * 255);
+		scene.push_back(new Sphere(position, (0.05f + unit(rng) * 0.2f) * scale, color));
+	}
+	lights.push_back(new Light(glm::vec3(-5, 3, 3), 40.0f));
+	lights.push_back(new Light(glm::vec3(0, 5, -1), 50.0f));
+	lights.push_back(new Light(glm::vec3(3, 2, 5), 50.0f));
+}
+
+static void freeScene(vector<SceneObject*>& scene, vector<Light*>& lights) {
+	for (auto obj : scene) delete obj;
+	for (auto light : lights) delete light;
+	scene.clear();
+	lights.clear();
+}
+
+static bool selected(const BenchmarkOptions& options, const string& name) {
+	return options.filter.empty() || name.find(options.filter) != string::npos;
+}
+
+static void report(vector<BenchmarkResult>& results, const BenchmarkResult& result) {
+	cout << std::left << std::setw(32) << result.name << std::right << std::setw(14) << std::fixed << std::setprecision(2)
+		<< result.nsPerOp() << " ns/" << std::left << std::setw(14) << result.unit << std::right << std::setw(14)
+		<< std::setprecision(0) << result.opsPerSecond() << " " << result.unit << "/s";
+	if (!result.detail.empty()) cout << "  (" << result.detail << ")";
+	cout << endl;
+	results.push_back(result);
+}
+
+static void kernelBenchmarks(const BenchmarkOptions& options, vector<BenchmarkResult>& results) {
+	std::mt19937 rng(1);
+	vector<Ray> rays = randomRays(1 << 16, rng);
+
+	if (selected(options, "sphere_intersect")) {
+		Sphere sphere(glm::vec3(0, 1, -2), 2.0f);
+		report(results, measure(options, "sphere_intersect", "intersection", rays.size(), [&]() {
+			uint64_t hits = 0;
+			glm::vec3 point, normal;
+			for (const Ray& ray : rays) hits += sphere.intersect(ray, point, normal);
+			sink += hits;
+		}));
+	}
+	if (selected(options, "plane_intersect")) {
+		Plane plane(glm::vec3(0, -1, 0), glm::vec3(0, 1, 0));
+		report(results, measure(options, "plane_intersect", "intersection", rays.size(), [&]() {
+			uint64_t hits = 0;
+			glm::vec3 point, normal;
+			for (const Ray& ray : rays) hits += plane.intersect(ray, point, normal);
+			sink += hits;
+		}));
+	}
+
+	// the compiled default scene, and shading points on it
+	//
+	vector<SceneObject*> scene;
+	vector<Light*> lights;
+	bool textured;
+	defaultScene(scene, lights, textured);
+	RenderScene renderScene;
+	renderScene.compile(scene, lights, RenderCam());
+
+	vector<int> hitPrims;
+	vector<glm::vec3> hitPoints, hitNormals;
+	for (const Ray& ray : rays) {
+		glm::vec3 point, normal;
+		int prim = renderScene.closestHit(ray, point, normal);
+		if (prim < 0) continue;
+		hitPrims.push_back(prim);
+		hitPoints.push_back(point);
+		hitNormals.push_back(normal);
+	}
+
+	if (selected(options, "closest_hit")) {
+		report(results, measure(options, "closest_hit", "ray", rays.size(), [&]() {
+			uint64_t hits = 0;
+			glm::vec3 point, normal;
+			for (const Ray& ray : rays) hits += renderScene.closestHit(ray, point, normal) >= 0;
+			sink += hits;
+		}));
+	}
+	if (selected(options, "in_shadow")) {
+		glm::vec3 light = renderScene.lightPosition[1];
+		report(results, measure(options, "in_shadow", "ray", hitPoints.size(), [&]() {
+			uint64_t shadowed = 0;
+			for (const glm::vec3& p : hitPoints) shadowed += renderScene.inShadow(Ray(p, glm::normalize(light - p)));
+			sink += shadowed;
+		}));
+	}
+	if (selected(options, "phong")) {
+		glm::vec3 diffuse = linearColor(ofColor::darkKhaki), specular = linearColor(ofColor::lightGray);
+		BenchmarkResult result = measure(options, "phong", "point", hitPoints.size(), [&]() {
+			ShadowCache cache;
+			cache.reset(renderScene.lightPosition.size());
+			glm::vec3 sum(0);
+			for (int i = 0; i < hitPoints.size(); i++) sum += renderScene.phong(hitPoints[i], hitNormals[i], diffuse, specular, 1000.0, &cache);
+			sink += uint64_t(sum.x);
+		});
+		result.detail = ofToString((int)renderScene.lightPosition.size()) + " lights";
+		report(results, result);
+	}
+	if (selected(options, "shade")) {
+		BenchmarkResult result = measure(options, "shade", "point", hitPoints.size(), [&]() {
+			ShadowCache cache;
+			cache.reset(renderScene.lightPosition.size());
+			glm::vec3 sum(0);
+			for (int i = 0; i < hitPoints.size(); i++) sum += renderScene.shade(hitPrims[i], hitPoints[i], hitNormals[i], &cache);
+			sink += uint64_t(sum.x);
+		});
+		result.detail = textured ? "textured" : "textures not found";
+		report(results, result);
+	}
+	freeScene(scene, lights);
+
+	// packet tracing of camera rays through a 10k sphere scene, with each instruction set
+	//
+	sphereScene(10000, scene, lights);
+	renderScene.compile(scene, lights, RenderCam());
+	vector<RayPacket> packets;
+	for (int j = 0; j < 128; j++) {
+		for (int i = 0; i < 128; i += packetSize) {
+			RayPacket packet;
+			packet.clear();
+			for (int k = 0; k < packetSize; k++) {
+				Ray ray = renderScene.camera.getRay((i + k + 0.5f) / 128, (j + 0.5f) / 128);
+				packet.setRay(k, ray.p, ray.d);
+			}
+			packets.push_back(packet);
+		}
+	}
+	PacketISA best = getPacketISA();
+	for (int isa = PACKET_ISA_SCALAR; isa <= PACKET_ISA_AVX2; isa++) {
+		string name = string("packet_trace_") + ofToLower(packetISAName((PacketISA)isa));
+		if (!selected(options, name) || !setPacketISA((PacketISA)isa)) continue;
+		BenchmarkResult result = measure(options, name, "ray", packets.size() * packetSize, [&]() {
+			uint64_t hits = 0;
+			for (const RayPacket& p : packets) {
+				RayPacket packet = p;
+				tracePacket(renderScene.packetScene, packet);
+				for (int k = 0; k < packetSize; k++) hits += packet.prim[k] >= 0;
+			}
+			sink += hits;
+		});
+		result.detail = "10k spheres";
+		report(results, result);
+	}
+	setPacketISA(best);
+	freeScene(scene, lights);
+}
+
+// compile and render a whole frame on all threads.  Compiling is timed on its own
+//
+static void frameBenchmark(const BenchmarkOptions& options, vector<BenchmarkResult>& results, const string& name,
+	vector<SceneObject*>& scene, vector<Light*>& lights, int width, int height, const string& detail) {
+	RenderScene renderScene;
+	ThreadPool pool(options.threads);
+	ProgressiveRenderer renderer(pool);
+	renderer.setCoarsePasses(false);
+
+	BenchmarkOptions once = options;
+	once.minTime = 0;     // big scenes take long enough to compile
+	BenchmarkResult compile = measure(once, name + "_compile", "prim", scene.size(), [&]() {
+		renderScene.compile(scene, lights, RenderCam());
+	});
+	compile.detail = detail;
+	report(results, compile);
+
+	BenchmarkResult frame = measure(options, name, "ray", uint64_t(width) * height, [&]() {
+		renderer.start(&renderScene, width, height, 0);
+		renderer.wait();
+	});
+	frame.detail = detail + ", " + ofToString(width) + "x" + ofToString(height) + ", " + ofToString(pool.getNumThreads()) + " threads, "
+		+ ofToString(frame.seconds * 1000, 1) + " ms/frame";
+	report(results, frame);
+}
+
+static void frameBenchmarks(const BenchmarkOptions& options, vector<BenchmarkResult>& results) {
+	vector<SceneObject*> scene;
+	vector<Light*> lights;
+
+	if (selected(options, "frame_default")) {
+		bool textured;
+		defaultScene(scene, lights, textured);
+		frameBenchmark(options, results, "frame_default", scene, lights, 2400, 1600, textured ? "setup() scene" : "setup() scene, textures not found");
+		freeScene(scene, lights);
+	}
+
+	vector<int> counts = { 1000, 10000, 100000 };
+	if (!options.quick) counts.push_back(1000000);
+	for (int n : counts) {
+		string name = "frame_spheres_" + (n >= 1000000 ? ofToString(n / 1000000) + "m" : ofToString(n / 1000) + "k");
+		if (!selected(options, name)) continue;
+		sphereScene(n, scene, lights);
+		frameBenchmark(options, results, name, scene, lights, options.frameWidth, options.frameHeight, ofToString(n) + " spheres");
+		freeScene(scene, lights);
+	}
+}
+
+static bool writeResults(const string& path, const vector<BenchmarkResult>& results, const BenchmarkOptions& options) {
+	std::ofstream file(path);
+	if (!file) return false;
+	file << "{" << endl;
+	file << "  \"isa\": \"" << packetISAName(getPacketISA()) << "\"," << endl;
+	file << "  \"threads\": " << options.threads << "," << endl;
+	file << "  \"results\": [" << endl;
+	for (int i = 0; i < results.size(); i++) {
+		const BenchmarkResult& r = results[i];
+		file << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"ops\": " << r.ops
+			<< ", \"runs\": " << r.runs << ", \"ns_per_op\": " << std::setprecision(6) << r.nsPerOp()
+			<< ", \"ops_per_sec\": " << std::setprecision(6) << r.opsPerSecond() << ", \"detail\": \"" << r.detail << "\"}"
+			<< (i + 1 < results.size() ? "," : "") << endl;
+	}
+	file << "  ]" << endl;
+	file << "}" << endl;
+	return bool(file);
+}
+
+// read the ns per operation of every benchmark in a file written by writeResults
+//
+static bool readResults(const string& path, std::map<string, double>& nsPerOp) {
+	std::ifstream file(path);
+	if (!file) return false;
+	string line;
+	while (std::getline(file, line)) {
+		size_t name = line.find("\"name\": \"");
+		size_t ns = line.find("\"ns_per_op\": ");
+		if (name == string::npos || ns == string::npos) continue;
+		name += 9;
+		nsPerOp[line.substr(name, line.find('"', name) - name)] = atof(line.c_str() + ns + 13);
+	}
+	return true;
+}
+
+// compare against the baseline.  Returns false if anything is slower than tolerance
+// allows
+//
+static bool compareResults(const vector<BenchmarkResult>& results, const std::map<string, double>& baseline, double tolerance) {
+	bool ok = true;
+	cout << endl << "against the baseline:" << endl;
+	for (const BenchmarkResult& r : results) {
+		auto found = baseline.find(r.name);
+		if (found == baseline.end()) continue;
+		double change = r.nsPerOp() / found->second - 1;
+		bool slower = change > tolerance;
+		cout << std::left << std::setw(32) << r.name << std::right << std::setw(8) << std::fixed << std::setprecision(1)
+			<< change * 100 << "%" << (slower ? "  SLOWER" : "") << endl;
+		if (slower) ok = false;
+	}
+	return ok;
+}
+
+static void usage() {
+	cerr << "usage: benchmark [options]" << endl
+		<< "  -o file       write the results as JSON" << endl
+		<< "  -b file       compare against results written earlier with -o" << endl
+		<< "  -r tolerance  slowdown allowed against the baseline (default 0.1 = 10%)" << endl
+		<< "  -k name       run only the benchmarks whose name contains this" << endl
+		<< "  -m seconds    minimum time per benchmark (default 0.5)" << endl
+		<< "  -t threads    threads for the frame benchmarks (default all hardware threads)" << endl
+		<< "  -w width      frame size of the sphere scenes (default 1200x800)" << endl
+		<< "  -h height" << endl
+		<< "  -d dir        where the default scene's textures are (default the current directory)" << endl
+		<< "  -q 0|1        quick run:  no 1M sphere scene (default 0)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+	BenchmarkOptions options;
+	string outPath, baselinePath;
+	double tolerance = 0.1;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg.size() != 2 || arg[0] != '-' || i + 1 >= argc) {
+			usage();
+			return 2;
+		}
+		string value = argv[++i];
+		switch (arg[1]) {
+		case 'o': outPath = value; break;
+		case 'b': baselinePath = value; break;
+		case 'r': tolerance = ofToFloat(value); break;
+		case 'k': options.filter = value; break;
+		case 'm': options.minTime = ofToFloat(value); break;
+		case 't': options.threads = ofToInt(value); break;
+		case 'w': options.frameWidth = ofToInt(value); break;
+		case 'h': options.frameHeight = ofToInt(value); break;
+		case 'd': options.dataPath = value; break;
+		case 'q': options.quick = ofToInt(value) != 0; break;
+		default: usage(); return 2;
+		}
+	}
+	if (options.threads < 1 || options.frameWidth < 1 || options.frameHeight < 1) {
+		usage();
+		return 2;
+	}
+
+	// like batchRender, paths are relative to where we were started
+	//
+	string dataPath = ofFilePath::getCurrentWorkingDirectory();
+	if (!options.dataPath.empty()) dataPath = ofFilePath::isAbsolute(options.dataPath) ? options.dataPath : ofFilePath::join(dataPath, options.dataPath);
+	ofSetDataPathRoot(dataPath + "/");
+
+	cout << "packet kernels: " << packetISAName(getPacketISA()) << ", frame threads: " << options.threads << endl << endl;
+	vector<BenchmarkResult> results;
+	kernelBenchmarks(options, results);
+	frameBenchmarks(options, results);
+
+	if (!outPath.empty() && !writeResults(outPath, results, options)) {
+		cerr << "cannot write " << outPath << endl;
+		return 1;
+	}
+	if (!baselinePath.empty()) {
+		std::map<string, double> baseline;
+		if (!readResults(baselinePath, baseline)) {
+			cerr << "cannot read " << baselinePath << endl;
+			return 1;
+		}
+		if (!compareResults(results, baseline, tolerance)) return 1;
+	}
+	return 0;
+}
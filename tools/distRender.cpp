@@ -0,0 +1,361 @@
+//  Distributed renderer
+//
+//  Renders a scene file like batchRender, spread over worker processes.  A coordinator
+//  cuts the image into tiles and starts the workers, fork()ed copies of itself, each
+//  connected to it by a socket pair.  Every worker loads its own copy of the scene and
+//  traces the tiles it is sent with the same ProgressiveRenderer as batchRender, so
+//  the assembled image is the one batchRender makes (adaptive sampling aside, which
+//  only looks at the neighbours of a pixel inside its own tile here).
+//
+//  Tiles are handed out one at a time:  a worker gets its next tile as soon as it sends
+//  one back, so cheap and expensive tiles, and fast and slow workers, balance out.  A
+//  worker that exits, breaks its connection or takes longer than the timeout over a
+//  tile is dropped (and killed), and its tile goes back on the queue for the others.
+//
+//  The messages are a TileMessage, and after a finished tile its pixels as the float
+//  RGBA of FrameBuffer, rows top to bottom.  Both ends are on one machine, so they are
+//  in its byte order.
+//
+//  Like batchRender it is built by tools/Makefile, not with the app.  POSIX only.
+//
+
+#include "sceneBinary.h"
+#include "progressiveRenderer.h"
+#include <deque>
+#include <cerrno>
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif
+
+//  A tile in the tile coordinates of ProgressiveRenderer (rows counted from the
+//  bottom).  id is the tile's number, or one of the codes below
+//
+struct TileMessage {
+	enum { ready = -1, quit = -2 };
+
+	int32_t id;
+	int32_t x0, y0, x1, y1;
+};
+
+struct DistOptions {
+	string scenePath;
+	int width = 2400, height = 1600;
+	int samples = 1;
+	float adaptive = 0;
+	float lightCutoff = 0;
+	int filter = 1;
+	int workers = 4;
+	int threads = 1;              // per worker
+	int tileSize = 128;
+	float timeout = 120;          // seconds a worker may spend on one tile, 0 = no limit
+};
+
+static void usage() {
+	cerr << "usage: distRender scene.txt|scene.rscn [options]" << endl
+		<< "  -o file     output image, format from the extension (default render.png).  .pfm" << endl
+		<< "              and .exr write the float image without tonemapping" << endl
+		<< "  -w width    image width (default 2400)" << endl
+		<< "  -h height   image height (default 1600)" << endl
+		<< "  -s n        n x n samples per pixel (default 1)" << endl
+		<< "  -a noise    adaptive sampling, as in batchRender (default 0)" << endl
+		<< "  -f 0|1      filtered (mipmapped) textures (default 1)" << endl
+		<< "  -l cutoff   inverse square light falloff, as in batchRender (default 0)" << endl
+		<< "  -e exposure exposure before tonemapping (default 1)" << endl
+		<< "  -r 0|1      Reinhard tonemap instead of clipping (default 0)" << endl
+		<< "  -j workers  worker processes (default one per hardware thread)" << endl
+		<< "  -t threads  render threads per worker (default 1)" << endl
+		<< "  -T size     tile size handed to a worker, rounded up to a multiple of 32 (default 128)" << endl
+		<< "  -k seconds  drop a worker that takes longer than this over a tile (default 120, 0 = never)" << endl;
+}
+
+#ifndef _WIN32
+
+// whole messages over a stream socket.  False if the other end has gone
+//
+static bool writeAll(int fd, const void* data, size_t size) {
+	const char* p = (const char*)data;
+	while (size > 0) {
+		ssize_t n = write(fd, p, size);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool readAll(int fd, void* data, size_t size) {
+	char* p = (char*)data;
+	while (size > 0) {
+		ssize_t n = read(fd, p, size);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+// Worker
+//
+// load the scene, say so, then render tiles until told to quit.  All tiles go into one
+// image, set up empty by the first start() and filled in by restart()
+//
+static int runWorker(int fd, const DistOptions& options) {
+	SceneDescription objects;
+	RenderScene scene;
+	string error;
+	if (!loadRenderScene(options.scenePath, scene, objects, error)) {
+		cerr << error << endl;
+		return 1;
+	}
+	scene.filterTextures = options.filter != 0;
+	scene.lightFalloff = options.lightCutoff > 0;
+	if (scene.lightFalloff) scene.lightCutoff = options.lightCutoff;
+	scene.setupLights();
+
+	ThreadPool pool(options.threads);
+	ProgressiveRenderer renderer(pool);
+	renderer.setCoarsePasses(false);
+	renderer.setAdaptive(options.adaptive);
+	renderer.start(&scene, options.width, options.height, options.samples, vector<Tile>());
+	renderer.wait();
+
+	TileMessage message = { TileMessage::ready, 0, 0, 0, 0 };
+	if (!writeAll(fd, &message, sizeof(message))) return 1;
+	vector<float> pixels;
+	while (readAll(fd, &message, sizeof(message)) && message.id != TileMessage::quit) {
+		Tile tile = { message.x0, message.y0, message.x1, message.y1 };
+		renderer.restart(&scene, options.width, options.height, options.samples, { tile });
+		renderer.wait();
+
+		const FrameBuffer& image = renderer.getFrameBuffer();
+		pixels.resize(size_t(tile.width()) * tile.height() * 4);
+		float* out = pixels.data();
+		for (int y = options.height - tile.y1; y < options.height - tile.y0; y++) {
+			const float* row = image.getData() + 4 * (size_t(y) * options.width + tile.x0);
+			std::copy(row, row + 4 * tile.width(), out);
+			out += 4 * tile.width();
+		}
+		if (!writeAll(fd, &message, sizeof(message)) || !writeAll(fd, pixels.data(), pixels.size() * sizeof(float))) return 1;
+	}
+	objects.clear();
+	return 0;
+}
+
+// Coordinator
+//
+struct WorkerProcess {
+	pid_t pid = -1;
+	int fd = -1;
+	bool ready = false;
+	int tile = -1;                // the tile it is rendering, or -1
+	uint64_t tileStart = 0;
+	int tilesDone = 0;
+};
+
+static void dropWorker(WorkerProcess& w, std::deque<int>& queue, const string& why) {
+	cerr << "worker " << w.pid << " dropped: " << why;
+	if (w.tile >= 0) {
+		cerr << ", tile " << w.tile << " handed out again";
+		queue.push_front(w.tile);
+	}
+	cerr << endl;
+	kill(w.pid, SIGKILL);
+	close(w.fd);
+	waitpid(w.pid, nullptr, 0);
+	w.fd = -1;
+	w.tile = -1;
+}
+
+static bool sendTile(WorkerProcess& w, std::deque<int>& queue, const vector<Tile>& tiles) {
+	int id = queue.front();
+	const Tile& t = tiles[id];
+	TileMessage message = { id, t.x0, t.y0, t.x1, t.y1 };
+	if (!writeAll(w.fd, &message, sizeof(message))) return false;
+	queue.pop_front();
+	w.tile = id;
+	w.tileStart = ofGetElapsedTimeMillis();
+	return true;
+}
+
+// render the image on the workers into image.  False if every worker was lost before
+// the last tile came back
+//
+static bool coordinate(const DistOptions& options, FrameBuffer& image) {
+	vector<WorkerProcess> workers(options.workers);
+	for (int k = 0; k < workers.size(); k++) {
+		int sockets[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+			cerr << "cannot create a socket pair" << endl;
+			return false;
+		}
+		pid_t pid = fork();
+		if (pid == 0) {
+			// the child keeps only its own end, so every worker sees the coordinator go
+			close(sockets[0]);
+			for (int j = 0; j < k; j++) close(workers[j].fd);
+			_exit(runWorker(sockets[1], options));
+		}
+		close(sockets[1]);
+		if (pid < 0) {
+			close(sockets[0]);
+			cerr << "cannot start a worker" << endl;
+			continue;
+		}
+		workers[k].pid = pid;
+		workers[k].fd = sockets[0];
+	}
+
+	vector<Tile> tiles = makeTiles(options.width, options.height, options.tileSize);
+	std::deque<int> queue;
+	for (int i = 0; i < tiles.size(); i++) queue.push_back(i);
+	int remaining = tiles.size();
+	vector<float> pixels;
+
+	while (remaining > 0) {
+		vector<pollfd> fds;
+		vector<WorkerProcess*> polled;
+		for (WorkerProcess& w : workers) {
+			if (w.fd < 0) continue;
+			fds.push_back({ w.fd, POLLIN, 0 });
+			polled.push_back(&w);
+		}
+		if (fds.empty()) {
+			cerr << "every worker was lost, " << remaining << " tiles not rendered" << endl;
+			return false;
+		}
+		if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) return false;
+
+		for (int k = 0; k < fds.size(); k++) {
+			WorkerProcess& w = *polled[k];
+			if (fds[k].revents != 0) {
+				TileMessage message;
+				if (!readAll(w.fd, &message, sizeof(message))) {
+					dropWorker(w, queue, "connection closed");
+					continue;
+				}
+				if (message.id == TileMessage::ready) w.ready = true;
+				else if (message.id != w.tile) {
+					dropWorker(w, queue, "sent a tile it was not asked for");
+					continue;
+				}
+				else {
+					const Tile& t = tiles[w.tile];
+					pixels.resize(size_t(t.width()) * t.height() * 4);
+					if (!readAll(w.fd, pixels.data(), pixels.size() * sizeof(float))) {
+						dropWorker(w, queue, "connection closed");
+						continue;
+					}
+					const float* in = pixels.data();
+					for (int y = options.height - t.y1; y < options.height - t.y0; y++) {
+						std::copy(in, in + 4 * t.width(), image.getData() + 4 * (size_t(y) * options.width + t.x0));
+						in += 4 * t.width();
+					}
+					w.tile = -1;
+					w.tilesDone++;
+					remaining--;
+				}
+			}
+			else if (w.tile >= 0 && options.timeout > 0 && ofGetElapsedTimeMillis() - w.tileStart > options.timeout * 1000) {
+				dropWorker(w, queue, "timed out");
+			}
+		}
+
+		// then everyone idle gets a tile, including the ones dropped workers left
+		//
+		for (WorkerProcess& w : workers) {
+			if (w.fd >= 0 && w.ready && w.tile < 0 && !queue.empty() && !sendTile(w, queue, tiles)) dropWorker(w, queue, "connection closed");
+		}
+	}
+
+	for (WorkerProcess& w : workers) {
+		if (w.fd < 0) continue;
+		TileMessage message = { TileMessage::quit, 0, 0, 0, 0 };
+		writeAll(w.fd, &message, sizeof(message));
+		close(w.fd);
+		waitpid(w.pid, nullptr, 0);
+		cout << "worker " << w.pid << ": " << w.tilesDone << " tiles" << endl;
+	}
+	return true;
+}
+
+#endif
+
+int main(int argc, char* argv[]) {
+	DistOptions options;
+	options.workers = ThreadPool::hardwareThreads();
+	string outPath = "render.png";
+	ToneMap toneMap;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+			string value = argv[++i];
+			switch (arg[1]) {
+			case 'o': outPath = value; break;
+			case 'w': options.width = ofToInt(value); break;
+			case 'h': options.height = ofToInt(value); break;
+			case 's': options.samples = ofToInt(value); break;
+			case 'a': options.adaptive = ofToFloat(value); break;
+			case 'f': options.filter = ofToInt(value); break;
+			case 'l': options.lightCutoff = ofToFloat(value); break;
+			case 'e': toneMap.exposure = ofToFloat(value); break;
+			case 'r': toneMap.op = ofToInt(value) ? ToneMap::REINHARD : ToneMap::CLAMP; break;
+			case 'j': options.workers = ofToInt(value); break;
+			case 't': options.threads = ofToInt(value); break;
+			case 'T': options.tileSize = ofToInt(value); break;
+			case 'k': options.timeout = ofToFloat(value); break;
+			default: usage(); return 2;
+			}
+		}
+		else if (arg[0] != '-' && options.scenePath.empty()) options.scenePath = arg;
+		else {
+			usage();
+			return 2;
+		}
+	}
+	if (options.scenePath.empty() || options.width < 1 || options.height < 1 || options.samples < 1 ||
+		options.workers < 1 || options.threads < 1 || options.tileSize < 1) {
+		usage();
+		return 2;
+	}
+
+	// worker tiles are whole tiles of the renderer's own grid, so they trace the same
+	// pixels the same way as one render of the whole image
+	//
+	options.tileSize = (options.tileSize + 31) / 32 * 32;
+
+#ifdef _WIN32
+	cerr << "distRender needs fork() and socket pairs, which this platform does not have" << endl;
+	return 1;
+#else
+	ofSetDataPathRoot(ofFilePath::getCurrentWorkingDirectory() + "/");
+	signal(SIGPIPE, SIG_IGN);
+
+	uint64_t start = ofGetElapsedTimeMillis();
+	FrameBuffer image;
+	image.allocate(options.width, options.height);
+	if (!coordinate(options, image)) return 1;
+
+	bool saved;
+	if (FrameBuffer::isHDRFile(outPath))
+		saved = image.save(outPath);
+	else {
+		ofPixels pixels;
+		image.resolve(pixels, toneMap);
+		saved = ofSaveImage(pixels, outPath);
+	}
+	if (!saved) {
+		cerr << "cannot write " << outPath << endl;
+		return 1;
+	}
+	cout << outPath << ": " << options.width << "x" << options.height << ", " << options.samples << "x" << options.samples << " samples, "
+		<< ofGetElapsedTimeMillis() - start << " ms, " << options.workers << " workers of " << options.threads << " threads" << endl;
+	return 0;
+#endif
+}
@@ -0,0 +1,52 @@
+//  Scene converter
+//
+//  Converts between the text scene format (for authoring) and the binary one (for
+//  loading big scenes fast), by file extension:
+//
+//    sceneConvert scene.txt scene.rscn
+//    sceneConvert scene.rscn scene.txt
+//
+//  Like batchRender it is built by tools/Makefile, not with the app.
+//
+
+#include "sceneBinary.h"
+
+int main(int argc, char* argv[]) {
+	if (argc != 3) {
+		cerr << "usage: sceneConvert in.txt|in.rscn out.txt|out.rscn" << endl;
+		return 2;
+	}
+	string inPath = argv[1], outPath = argv[2];
+	ofSetDataPathRoot(ofFilePath::getCurrentWorkingDirectory() + "/");
+
+	// a binary scene can be converted without its textures, a text scene needs them to
+	// compile
+	//
+	SceneDescription objects;
+	RenderScene scene;
+	string error;
+	if (!loadRenderScene(inPath, scene, objects, error, false)) {
+		cerr << error << endl;
+		return 1;
+	}
+
+	bool saved;
+	if (isBinarySceneFile(outPath)) {
+		saved = saveBinaryScene(outPath, scene, error);
+	}
+	else {
+		SceneDescription desc;
+		describeScene(scene, desc, false);
+		saved = saveSceneFile(outPath, desc);
+		if (!saved) error = "cannot write " + outPath;
+		desc.clear();
+	}
+	objects.clear();
+	if (!saved) {
+		cerr << error << endl;
+		return 1;
+	}
+	cout << outPath << ": " << scene.numSpheres() << " spheres, " << scene.numPlanes() << " planes, "
+		<< scene.lightPosition.size() << " lights" << endl;
+	return 0;
+}